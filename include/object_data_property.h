@@ -11,6 +11,7 @@
 
 #include <Eigen/Geometry>
 #include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionShapes/btShapeHull.h>
 
 // Contains function for loading an object from file
 #include "bcs_loader.h"
@@ -24,6 +25,9 @@ typedef btCollisionShape objectShape;
 
 enum background_mode {BACKGROUND_PLANE, BACKGROUND_HULL, BACKGROUND_MESH};
 
+// Collision shape levels of an object model, from the cheapest to the most exact
+enum CollisionDetailLevel {COLLISION_DETAIL_OBB, COLLISION_DETAIL_HULL, COLLISION_DETAIL_FULL, NUMBER_OF_COLLISION_DETAIL_LEVELS};
+
 struct Obb
 {
 	// oriented bounding box
@@ -36,6 +40,27 @@ struct Obb
 	void generateObb(std::vector<btVector3> corner_points);
 };
 
+// Collision shapes of one object model at every detail level. Every level is a compound shape in the frame
+// of the full shape, so a body can switch its level without moving. Each shape points to this struct
+// with its user pointer.
+struct CollisionDetailShapes
+{
+	objectShapePtr shapes_[NUMBER_OF_COLLISION_DETAIL_LEVELS];
+	// oriented bounding box of the full shape including the collision margin, in the scaled shape frame
+	btTransform obb_pose_;
+	btVector3 obb_half_extents_;
+};
+
+// returns NULL if the shape of the object has no detail levels
+inline const CollisionDetailShapes* getCollisionDetailShapes(const btCollisionObject* object)
+{
+	return static_cast<const CollisionDetailShapes*>(object->getCollisionShape()->getUserPointer());
+}
+
+// Separating axis test of two oriented boxes, the first box is grown by margin
+bool checkObbOverlap(const btTransform &pose_a, const btVector3 &half_extents_a, 
+	const btTransform &pose_b, const btVector3 &half_extents_b, const btScalar &margin);
+
 struct PhysicalProperties
 {
 	btScalar mass_;
@@ -75,7 +100,7 @@ public:
 	// NOTE: Object class and its' inheritance Has a potential memory leak since it allocates mesh using standard pointer.
 	// Since every mesh pointed by this Object is copied to ObjectDatabase class, it does not leak.
 
-	Object() : physical_data_ready_(false) {};
+	Object() : physical_data_ready_(false), detail_shapes_(NULL) {};
 	// ~Object();
 	void setPhysicalProperties(const objectShapePtr mesh, const PhysicalProperties &physical_properties);
 	void shallowCopyPhysicalProperties(objectShapePtr &mesh_out, PhysicalProperties &physical_properties_out) const;
@@ -87,8 +112,14 @@ public:
 
 	// generate rigid body data that can be added to the bullet physics world
 	btRigidBody* generateRigidBody(const btTransform &transform) const;
+	// mass, shape, inertia, friction and damping of the rigid bodies of this object
+	btRigidBody::btRigidBodyConstructionInfo getRigidBodyConstructionInfo(btMotionState* motion_state) const;
 	btVector3 getInertiaVector() const;
 	objectShapePtr getCollisionShape() const;
+	// falls back to the full shape if the detail levels have not been generated
+	objectShapePtr getCollisionShape(const int &detail_level) const;
+	// build the bounding box and the simplified hull levels of a compound mesh, after computeObb
+	bool generateCollisionDetailShapes();
 
 	void getObbProperty(Obb &entire_shape_obb, std::vector<Obb> &child_shape_obb) const;
 	void copyObbProperty(const Object& other);
@@ -104,6 +135,8 @@ protected:
 
 	Obb entire_shape_obb_;
 	std::vector<Obb> child_shape_obb_;
+	// shared by the shallow copies, like mesh_
+	CollisionDetailShapes* detail_shapes_;
 };
 
 // Object class with id information.
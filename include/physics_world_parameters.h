@@ -24,4 +24,15 @@ enum SimulationMode {
 	// CLEAR ALL FORCES ON EACH FRAME
 	RESET_INTERACTION_FORCES_ON_EACH_FRAME = 5
 };
+
+enum BroadphaseType {
+	// DYNAMIC AABB TREE, WORKS FOR ANY SCENE SIZE AND WORKSPACE
+	DBVT_BROADPHASE,
+
+	// SWEEP AND PRUNE INSIDE THE WORKSPACE BOUNDS, WHICH ARE FIT TO THE BACKGROUND
+	AXIS_SWEEP_BROADPHASE,
+
+	// TEST THE AABB OF EVERY PAIR OF OBJECTS, ONLY FOR SCENES WITH A FEW OBJECTS
+	BRUTE_FORCE_BROADPHASE
+};
 #endif
\ No newline at end of file
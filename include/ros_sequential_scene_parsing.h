@@ -26,6 +26,7 @@
 #include <objrec_hypothesis_msgs/Hypothesis.h>
 
 #include "sequential_scene_parsing.h"
+#include "scene_physics_engine_renderer.h"
 #include "symmetric_orientation_realignment.h"
 
 #include "sequential_scene_parsing/SceneNodes.h"
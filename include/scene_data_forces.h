@@ -45,7 +45,8 @@ public:
 	FeedbackDataForcesGenerator();
 	
 	void setFeedbackForceMode(int mode);
-	void applyFeedbackForces(btRigidBody &object, const std::string &model_name);
+	// returns the applied data force and torque
+	std::pair<btVector3, btVector3> applyFeedbackForces(btRigidBody &object, const std::string &model_name);
 	std::pair<btVector3, btVector3> applyFeedbackForcesDebug(const btTransform &object_real_pose, const std::string &model_name);
 
 	void setSceneData(PointCloudXYZPtr scene_data);
@@ -65,6 +66,9 @@ public:
 	void manualSetCachedIcpResultMapFromPose(const btTransform &object_pose,
 		const std::string &object_id, const std::string &model_name);
 	double getIcpConfidenceResult(const std::string &model_name, const btTransform &object_pose);
+	// run ICP on the object pose only if the object does not have a cached ICP result yet
+	void updateMissingCachedIcpResult(const btTransform &object_pose,
+		const std::string &object_id, const std::string &model_name);
 
 	void setDebugMode(const bool &debug_flag);
 	
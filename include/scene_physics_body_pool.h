@@ -0,0 +1,39 @@
+#ifndef SCENE_PHYSICS_BODY_POOL_H
+#define SCENE_PHYSICS_BODY_POOL_H
+
+#include <string>
+#include <vector>
+
+#include <btBulletDynamicsCommon.h>
+
+// Keeps the memory of released rigid bodies, their motion states and their names, so the bodies of objects
+// that appear and disappear between frames are constructed in place instead of allocated again.
+// The pooled memory never exceeds the largest number of bodies that were alive at the same time.
+class RigidBodyPool
+{
+public:
+	RigidBodyPool() {}
+	~RigidBodyPool();
+
+	// Construct a body with a pooled motion state at the transform. The body user pointer is its own copy of the
+	// object id, as read by getObjectIDFromCollisionObject. The motion state of the construction info is ignored.
+	btRigidBody* acquire(const std::string &object_id, btRigidBody::btRigidBodyConstructionInfo construction_info,
+		const btTransform &transform);
+	// Destroy a body from acquire, its motion state and its name. The body must not be in a world.
+	void release(btRigidBody* body);
+
+	std::size_t getNumberOfFreeBodies() const;
+	// free the memory of the released bodies
+	void clear();
+
+private:
+	// the pool owns memory, so it can not be copied
+	RigidBodyPool(const RigidBodyPool &other);
+	RigidBodyPool& operator=(const RigidBodyPool &other);
+
+	std::vector<void*> free_bodies_;
+	std::vector<void*> free_motion_states_;
+	std::vector<std::string*> free_names_;
+};
+
+#endif
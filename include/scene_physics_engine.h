@@ -5,25 +5,29 @@
 #include <math.h>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <deque>
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/graph/graphviz.hpp>
 
+#include <btBulletDynamicsCommon.h>
 #include <BulletCollision/CollisionDispatch/btCollisionWorld.h>
-
-// Rendering platform
-#ifdef _WINDOWS
-#include "debugdrawer/Win32DemoApplication.h"
-#define PlatformDemoApplication Win32DemoApplication
-#else
-#include "debugdrawer/GlutDemoApplication.h"
-#define PlatformDemoApplication GlutDemoApplication
+#include <BulletCollision/BroadphaseCollision/btSimpleBroadphase.h>
+#ifdef BT_THREADSAFE
+// Task scheduler world, available when Bullet (2.88+) and this package are built with BT_THREADSAFE
+#include <LinearMath/btThreads.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
 #endif
 
-#include "debugdrawer/GlutStuff.h"
-#include "debugdrawer/GLDebugDrawer.h"
-
 #include "object_data_property.h"
+#include "scene_physics_body_pool.h"
 
 #include "scene_physics_penalty.h"
 #include "scene_physics_support.h"
@@ -31,6 +35,69 @@
 
 static void _worldTickCallback(btDynamicsWorld *world, btScalar timeStep);
 
+// btDiscreteDynamicsWorld that can clear the leftover time carried between stepSimulation calls
+class SceneDynamicsWorld : public btDiscreteDynamicsWorld
+{
+public:
+	SceneDynamicsWorld(btDispatcher* dispatcher, btBroadphaseInterface* pair_cache,
+		btConstraintSolver* constraint_solver, btCollisionConfiguration* collision_configuration) :
+		btDiscreteDynamicsWorld(dispatcher, pair_cache, constraint_solver, collision_configuration) {}
+
+	void resetLocalTime()
+	{
+		m_localTime = 0;
+	}
+
+	// Collision detection and one constraint solver pass from the current poses, without moving the objects.
+	// The contact impulses are left in the contact manifolds and the solved velocities in the bodies.
+	void solveContactsWithoutIntegration(const btScalar &time_step)
+	{
+		applyGravity();
+		predictUnconstraintMotion(time_step);
+		btDispatcherInfo& dispatch_info = getDispatchInfo();
+		dispatch_info.m_timeStep = time_step;
+		dispatch_info.m_stepCount = 0;
+		performDiscreteCollisionDetection();
+		calculateSimulationIslands();
+		getSolverInfo().m_timeStep = time_step;
+		solveConstraints(getSolverInfo());
+		clearForces();
+	}
+};
+
+#ifdef BT_THREADSAFE
+// Same as SceneDynamicsWorld, but the collision detection, islands and constraint solving run on the Bullet task scheduler
+class SceneDynamicsWorldMt : public btDiscreteDynamicsWorldMt
+{
+public:
+	SceneDynamicsWorldMt(btDispatcher* dispatcher, btBroadphaseInterface* pair_cache,
+		btConstraintSolverPoolMt* solver_pool, btConstraintSolver* constraint_solver_mt, 
+		btCollisionConfiguration* collision_configuration) :
+		btDiscreteDynamicsWorldMt(dispatcher, pair_cache, solver_pool, constraint_solver_mt, collision_configuration) {}
+
+	void resetLocalTime()
+	{
+		m_localTime = 0;
+	}
+
+	// Collision detection and one constraint solver pass from the current poses, without moving the objects.
+	// The contact impulses are left in the contact manifolds and the solved velocities in the bodies.
+	void solveContactsWithoutIntegration(const btScalar &time_step)
+	{
+		applyGravity();
+		predictUnconstraintMotion(time_step);
+		btDispatcherInfo& dispatch_info = getDispatchInfo();
+		dispatch_info.m_timeStep = time_step;
+		dispatch_info.m_stepCount = 0;
+		performDiscreteCollisionDetection();
+		calculateSimulationIslands();
+		getSolverInfo().m_timeStep = time_step;
+		solveConstraints(getSolverInfo());
+		clearForces();
+	}
+};
+#endif
+
 struct MassProp
 {
 	MassProp() {}
@@ -43,16 +110,287 @@ struct MassProp
 	btVector3 inertia;
 };
 
-class PhysicsEngine : public PlatformDemoApplication
+// Thresholds for deciding that the simulated objects have settled. Values are in the scaled world unit.
+struct ConvergenceCriteria
+{
+	ConvergenceCriteria() : max_linear_velocity_(0.5), max_angular_velocity_(0.05), 
+		max_penetration_depth_(0.3), max_data_forces_change_(0.05), minimum_settled_ticks_(5) {}
+
+	btScalar max_linear_velocity_;
+	btScalar max_angular_velocity_;
+	btScalar max_penetration_depth_;
+	// maximum relative change of the total data forces magnitude between two ticks
+	btScalar max_data_forces_change_;
+	// number of consecutive settled ticks needed before stopping the simulation
+	unsigned int minimum_settled_ticks_;
+};
+
+// Quasi-static settling relaxes the objects toward their resting poses with inertial relaxation (FIRE).
+// The pseudo time step grows while the objects keep moving along their net forces, and an object
+// stops as soon as it moves against its net force.
+struct QuasiStaticParameters
+{
+	QuasiStaticParameters() : max_step_multiplier_(10.), step_increase_(1.1), step_decrease_(0.5),
+		mixing_start_(0.1), mixing_decrease_(0.99), minimum_positive_ticks_(5),
+		max_displacement_per_tick_(0.5), max_rotation_per_tick_(0.1) {}
+
+	// maximum pseudo time step, in multiples of the simulation step
+	btScalar max_step_multiplier_;
+	btScalar step_increase_, step_decrease_;
+	// fraction of the velocity that is turned toward the net force direction
+	btScalar mixing_start_, mixing_decrease_;
+	// ticks with positive power needed before the step grows
+	unsigned int minimum_positive_ticks_;
+	// in the scaled world unit and radian
+	btScalar max_displacement_per_tick_, max_rotation_per_tick_;
+};
+
+// Error-controlled time step for the settling simulations. The step shrinks while the deepest contact
+// penetration or the change of the data forces is above its tolerance, and grows back once the scene
+// has been calm for a few ticks. The same simulated time is covered as with the fixed step.
+struct AdaptiveTimestepParameters
+{
+	AdaptiveTimestepParameters() : min_step_multiplier_(0.125), max_step_multiplier_(1.), step_increase_(1.25),
+		step_decrease_(0.25), penetration_tolerance_(0.2), data_forces_change_tolerance_(0.2), minimum_calm_ticks_(3) {}
+
+	// step range, in multiples of the fixed internal step
+	btScalar min_step_multiplier_, max_step_multiplier_;
+	// growth of the step on a calm tick, and the largest reduction of the step on one tick
+	btScalar step_increase_, step_decrease_;
+	// deepest allowed contact penetration, in the scaled world unit
+	btScalar penetration_tolerance_;
+	// allowed relative change of the total data forces magnitude between two ticks
+	btScalar data_forces_change_tolerance_;
+	// ticks with the error below half of the tolerance needed before the step grows
+	unsigned int minimum_calm_ticks_;
+};
+
+// Internal steps taken by the last simulation call
+struct TimestepStatistics
+{
+	TimestepStatistics() : number_of_ticks_(0), simulated_time_(0), min_step_(0), max_step_(0),
+		number_of_step_decreases_(0), number_of_step_increases_(0), max_penetration_depth_(0) {}
+
+	btScalar getAverageStep() const
+		{ return number_of_ticks_ > 0 ? simulated_time_ / number_of_ticks_ : 0; }
+
+	unsigned int number_of_ticks_;
+	btScalar simulated_time_;
+	btScalar min_step_, max_step_;
+	// only counted with the adaptive time step
+	unsigned int number_of_step_decreases_, number_of_step_increases_;
+	btScalar max_penetration_depth_;
+};
+
+// Invalidation of the warm started contacts. A contact manifold only keeps the impulses of a previous world
+// state if its two objects kept their relative pose within these tolerances. The contact points that moved
+// more than the contact breaking threshold are never warm started.
+struct ContactWarmStartParameters
+{
+	ContactWarmStartParameters() : max_relative_translation_(0.01 * SCALING), max_relative_rotation_(0.1) {}
+
+	// in the scaled world unit and radian
+	btScalar max_relative_translation_, max_relative_rotation_;
+};
+
+// Geometric depenetration before the first tick of a simulation. Each iteration moves every dynamic object
+// along the contact normals of its overlaps, by half of the depth when the other object is dynamic too.
+struct DepenetrationParameters
+{
+	DepenetrationParameters() : max_iterations_(4), penetration_slop_(0.0005 * SCALING), 
+		max_translation_(0.02 * SCALING) {}
+
+	unsigned int max_iterations_;
+	// overlaps up to this depth are left to the contact solver, in the scaled world unit
+	btScalar penetration_slop_;
+	// longest total translation of an object, in the scaled world unit
+	btScalar max_translation_;
+};
+
+// In-memory state of the objects in a physics engine world, keyed by object id
+struct WorldCheckpoint
+{
+	struct BodyState
+	{
+		btTransform transform_;
+		btVector3 linear_velocity_, angular_velocity_;
+		int activation_state_;
+		btScalar deactivation_time_;
+	};
+	// contact manifolds are identified by the object ids and the child shape indices of the contact
+	typedef std::pair< std::pair<std::string, std::string>, std::pair<int, int> > ContactManifoldKey;
+
+	WorldCheckpoint() : have_contact_manifolds_(false), collision_detail_level_(COLLISION_DETAIL_FULL) {}
+	// checkpoint of objects at rest on the input poses
+	WorldCheckpoint(const std::map<std::string, btTransform> &object_pose_map) : 
+		best_test_pose_map_(object_pose_map), have_contact_manifolds_(false), collision_detail_level_(COLLISION_DETAIL_FULL)
+	{
+		BodyState rest_state;
+		rest_state.linear_velocity_ = rest_state.angular_velocity_ = btVector3(0,0,0);
+		rest_state.activation_state_ = ACTIVE_TAG;
+		rest_state.deactivation_time_ = 0;
+		for (std::map<std::string, btTransform>::const_iterator it = object_pose_map.begin(); 
+			it != object_pose_map.end(); ++it)
+		{
+			if (it->first == "background") continue;
+			rest_state.transform_ = it->second;
+			body_state_[it->first] = rest_state;
+		}
+	}
+
+	// only contains the objects that are in the world
+	std::map<std::string, BodyState> body_state_;
+	std::map<std::string, btTransform> best_test_pose_map_;
+
+	bool have_contact_manifolds_;
+	std::map<ContactManifoldKey, std::vector<btManifoldPoint> > contact_manifolds_;
+	// the contact manifolds only match the shapes of this collision detail level
+	int collision_detail_level_;
+};
+
+// Results of the last simulation, for readers that can not wait for a simulation running on another thread
+struct PhysicsEngineSnapshot
+{
+	std::map<std::string, btTransform> object_poses_;
+	SceneSupportGraph scene_graph_;
+	std::map<std::string, vertex_t> vertex_map_;
+};
+
+// Poses of the world collision objects for drawing. The shapes belong to the engine or the object database.
+struct PhysicsEngineRenderSnapshot
+{
+	PhysicsEngineRenderSnapshot() : version_(0) {}
+
+	unsigned long version_;
+	std::vector<std::string> object_id_;
+	std::vector<const btCollisionShape*> shape_;
+	std::vector<btTransform> pose_;
+	std::vector<int> activation_state_;
+};
+
+// Dense table of the objects added to an engine. The object handle is the index of the object in every array,
+// and the object id is only used to find the handle at the API boundary. Objects keep their handle until the
+// table is cleared, so the per tick loops are linear scans over the arrays.
+struct ObjectBodyTable
+{
+	std::size_t size() const
+	{
+		return rigid_body_.size();
+	}
+
+	bool getHandle(const std::string &object_id, std::size_t &handle) const
+	{
+		std::map<std::string, std::size_t>::const_iterator it = handle_map_.find(object_id);
+		if (it == handle_map_.end()) return false;
+		handle = it->second;
+		return true;
+	}
+
+	std::size_t addObject(const std::string &object_id, const std::string &object_class, btRigidBody* rigid_body,
+		const ObjectPenaltyParameters &penalty_parameters)
+	{
+		std::size_t handle = this->size();
+		handle_map_[object_id] = handle;
+		object_id_.push_back(object_id);
+		object_class_.push_back(object_class);
+		rigid_body_.push_back(rigid_body);
+		penalty_parameters_.push_back(penalty_parameters);
+		velocity_.push_back(MovementComponent());
+		acceleration_.push_back(MovementComponent());
+		velocity_cached_.push_back(false);
+		acceleration_cached_.push_back(false);
+		ignore_data_forces_.push_back(false);
+		original_ignore_data_forces_.push_back(false);
+		missing_frames_.push_back(0);
+		initial_penetration_.push_back(0);
+		return handle;
+	}
+
+	// the last object is moved to the handle of the removed object
+	void removeObject(const std::size_t &handle)
+	{
+		std::size_t last_handle = this->size() - 1;
+		handle_map_.erase(object_id_[handle]);
+		if (handle != last_handle)
+		{
+			handle_map_[object_id_[last_handle]] = handle;
+			object_id_[handle] = object_id_[last_handle];
+			object_class_[handle] = object_class_[last_handle];
+			rigid_body_[handle] = rigid_body_[last_handle];
+			penalty_parameters_[handle] = penalty_parameters_[last_handle];
+			velocity_[handle] = velocity_[last_handle];
+			acceleration_[handle] = acceleration_[last_handle];
+			velocity_cached_[handle] = velocity_cached_[last_handle];
+			acceleration_cached_[handle] = acceleration_cached_[last_handle];
+			ignore_data_forces_[handle] = ignore_data_forces_[last_handle];
+			original_ignore_data_forces_[handle] = original_ignore_data_forces_[last_handle];
+			missing_frames_[handle] = missing_frames_[last_handle];
+			initial_penetration_[handle] = initial_penetration_[last_handle];
+		}
+		object_id_.pop_back();
+		object_class_.pop_back();
+		rigid_body_.pop_back();
+		penalty_parameters_.pop_back();
+		velocity_.pop_back();
+		acceleration_.pop_back();
+		velocity_cached_.pop_back();
+		acceleration_cached_.pop_back();
+		ignore_data_forces_.pop_back();
+		original_ignore_data_forces_.pop_back();
+		missing_frames_.pop_back();
+		initial_penetration_.pop_back();
+	}
+
+	// forget the velocities of the previous simulation
+	void resetMotionHistory()
+	{
+		std::fill(velocity_cached_.begin(), velocity_cached_.end(), false);
+		std::fill(acceleration_cached_.begin(), acceleration_cached_.end(), false);
+	}
+
+	void clear()
+	{
+		handle_map_.clear();
+		object_id_.clear();
+		object_class_.clear();
+		rigid_body_.clear();
+		penalty_parameters_.clear();
+		velocity_.clear();
+		acceleration_.clear();
+		velocity_cached_.clear();
+		acceleration_cached_.clear();
+		ignore_data_forces_.clear();
+		original_ignore_data_forces_.clear();
+		missing_frames_.clear();
+		initial_penetration_.clear();
+	}
+
+	std::map<std::string, std::size_t> handle_map_;
+	std::vector<std::string> object_id_;
+	std::vector<std::string> object_class_;
+	std::vector<btRigidBody*> rigid_body_;
+	std::vector<ObjectPenaltyParameters> penalty_parameters_;
+	// velocity and acceleration from the last world tick, only valid when cached in the current simulation
+	std::vector<MovementComponent> velocity_, acceleration_;
+	std::vector<char> velocity_cached_, acceleration_cached_;
+	// the data forces flag before the object is made static
+	std::vector<char> ignore_data_forces_, original_ignore_data_forces_;
+	// number of addObjects calls since the object was last detected
+	std::vector<unsigned int> missing_frames_;
+	// total contact penetration depth before the depenetration pre-pass of the current simulation
+	std::vector<btScalar> initial_penetration_;
+};
+
+// Owns the Bullet world without any rendering dependency. Use PhysicsEngineRenderer to display the world.
+class PhysicsEngine
 {
 public:
 	PhysicsEngine();
-	virtual ~PhysicsEngine()
+	~PhysicsEngine()
 	{
 		exitPhysics();
 	}
 
-	GLDebugDrawer gDebugDraw;
 	// use plane as background (table)
 	void addBackgroundPlane(btVector3 plane_normal, btScalar plane_constant, btVector3 plane_center);
 	void addBackgroundConvexHull(const std::vector<btVector3> &plane_points, btVector3 plane_normal);
@@ -63,10 +401,21 @@ public:
 	void setGravityVectorDirection(const btVector3 &gravity);
 	void setGravityFromBackgroundNormal(const bool &input);
 	btVector3 getGravityDirection() const;
-	void addObjects(const std::vector<ObjectWithID> &objects);
+	// The referenced objects are not in this frame, but the scene still uses them, e.g. the support retained
+	// objects of the previous scene. They are never evicted.
+	void addObjects(const std::vector<ObjectWithID> &objects, 
+		const std::set<std::string> &referenced_objects = std::set<std::string>());
 	std::map<std::string, btTransform>  getUpdatedObjectPoses();
 	std::map<std::string, btTransform>  getCurrentObjectPoses();
 	void resetObjects(const bool &permanent_removal);
+	// Every addObjects call is one frame. Objects missing from more than this many frames are removed
+	// permanently, and their bodies go back to the body pool. 0 keeps every object that was ever added.
+	void setObjectEvictionFrames(const unsigned int &number_of_frames);
+	// Keep the removed objects in the broadphase, with an empty collision filter and the simulation disabled,
+	// so switching objects between the hypothesis tests does not rebuild their broadphase proxies.
+	// The world is then not rebuilt by restoreWorldCheckpoint, so the test results may depend on the
+	// previous tests on the same engine.
+	void setResidentBodies(const bool &flag);
 
 	void setObjectPenaltyDatabase(std::map<std::string, ObjectPenaltyParameters> * penalty_database);
 
@@ -76,13 +425,42 @@ public:
 	void setPhysicsSolverSetting(const int &m_numIterations, const bool randomize_order = true, 
 		const int &m_splitImpulse = 1, const btScalar &m_splitImpulsePenetrationThreshold = -0.02);
 
+	// Number of threads used to step the world. More than 1 thread uses the task scheduler world, which needs
+	// BT_THREADSAFE. The world is rebuilt, so this must be called before the background, the objects and
+	// the renderer are added. Returns false if the world was not changed.
+	bool setWorldThreadCount(const unsigned int &number_of_threads);
+	unsigned int getWorldThreadCount() const;
+	// Broadphase used by the world, one of BroadphaseType. The axis sweep bounds are the background bounds
+	// grown by workspace_margin, so that broadphase is rebuilt when the background is added. This must be
+	// called before the background and the objects are added. Returns false if the broadphase was not changed.
+	bool setBroadphase(const int &broadphase_type, const btScalar &workspace_margin = 0.5 * SCALING);
+	// Collision shape level of the objects, one of CollisionDetailLevel. Objects without detail levels
+	// always use their full shape.
+	void setCollisionDetailLevel(const int &detail_level);
+	int getCollisionDetailLevel() const;
+	// Skip the narrowphase of the object pairs whose oriented bounding boxes do not overlap, even though
+	// their axis aligned bounding boxes do.
+	void setObbPairCulling(const bool &flag);
+
 	void setDebugMode(bool debug);
-	void renderingLaunched(const bool &flag = true);
+	// While rendering is launched, the engine publishes the object poses for the renderer at most
+	// snapshots_per_second times per second of simulation. The simulation never waits for the renderer.
+	void renderingLaunched(const bool &flag = true, const double &snapshots_per_second = 30.);
+	// Copy the latest published poses. Returns false if nothing was published after last_version.
+	bool getRenderSnapshot(PhysicsEngineRenderSnapshot &snapshot, const unsigned long &last_version = 0);
+	// camera pose that looks at the background, for the renderer
+	void getCameraPositionAndTarget(btVector3 &cam_position, btVector3 &cam_target) const;
 
 	// Scene analysis
 	void resetObjectMotionState(const bool &reset_object_pose, const std::map<std::string, btTransform> &target_pose_map);
 	SceneSupportGraph getCurrentSceneGraph(std::map<std::string, vertex_t> &vertex_map);
-	SceneSupportGraph getUpdatedSceneGraph(std::map<std::string, vertex_t> &vertex_map);
+	// The window of ticks is always simulated when the poses are not settled, e.g. a freshly placed hypothesis
+	SceneSupportGraph getUpdatedSceneGraph(std::map<std::string, vertex_t> &vertex_map, const bool &poses_settled = true);
+	// Build the scene graph from one collision detection and solver pass on the current poses, without any
+	// dynamics tick. The objects are not moved, so it is meant for poses that are already settled.
+	SceneSupportGraph getContactSceneGraph(std::map<std::string, vertex_t> &vertex_map);
+	// When set, getUpdatedSceneGraph uses getContactSceneGraph instead of simulating a window of ticks on settled poses
+	void setContactOnlySceneGraph(const bool &flag);
 	void prepareSimulationForOneTestHypothesis(const std::string &object_id, const btTransform &object_pose, const bool &resetObjectPosition = true);
 	void prepareSimulationForWithBestTestPose();
 	void changeBestTestPoseMap(const std::string &object_id, const btTransform &object_pose);
@@ -91,6 +469,27 @@ public:
 	
 	// vertex_t getObjectVertexFromSupportGraph(const std::string &object_name, btTransform &object_position);
 	void stepSimulationWithoutEvaluation(const double & delta_time, const double &simulation_step, const bool &data_forces_enabled = true);
+	// Same as stepSimulationWithoutEvaluation, but stops as soon as the objects have settled.
+	// Returns the number of world ticks that were simulated.
+	unsigned int stepSimulationUntilConvergence(const double &max_delta_time, const double &simulation_step, 
+		const bool &data_forces_enabled = true);
+	void setConvergenceCriteria(const ConvergenceCriteria &criteria);
+	// Settle with quasi-static relaxation when the scene is not evaluated, i.e. in stepSimulationWithoutEvaluation
+	// and stepSimulationUntilConvergence. The settling stops when the objects are at rest, and the objects
+	// are left at rest, so the scene evaluation ticks are the same as with the velocity reset dynamics.
+	void setQuasiStaticSettling(const bool &flag);
+	void setQuasiStaticParameters(const QuasiStaticParameters &parameters);
+	// Use the adaptive time step when the scene is not evaluated and the quasi-static settling is off.
+	void setAdaptiveTimestep(const bool &flag);
+	void setAdaptiveTimestepParameters(const AdaptiveTimestepParameters &parameters);
+	// Push the overlapping objects apart before the first tick of the simulation that follows addObjects or
+	// restoreWorldCheckpoint. The penetration before the pre-pass is kept for the collision penalty.
+	void setDepenetrationPrepass(const bool &flag);
+	void setDepenetrationParameters(const DepenetrationParameters &parameters);
+	// step sizes of the last simulation call
+	TimestepStatistics getTimestepStatistics() const;
+	// number of world ticks simulated by the last simulation call
+	unsigned int getNumberOfSimulatedTicks() const;
 	void worldTickCallback(const btScalar &timeStep);
 
 	void setFeedbackDataForcesGenerator(FeedbackDataForcesGenerator *data_forces_generator);
@@ -108,54 +507,121 @@ public:
 
 	void contactTest(btCollisionObject* col_object, btCollisionWorld::ContactResultCallback& result);
 
-// Additional functions used for rendering:
-	void initPhysics();
-	void exitPhysics();
-
-	virtual void clientMoveAndDisplay();
-
-	virtual void displayCallback();
-	virtual void clientResetScene();
-
-	virtual void setCameraClippingPlaneNearFar(btScalar near, btScalar far = 10000.f);
-	virtual void setCameraPositionAndTarget(btVector3 cam_position, btVector3 cam_target);
-
-	static DemoApplication* Create()
-	{
-		PhysicsEngine* demo = new PhysicsEngine;
-		// demo->myinit();
-		demo->initPhysics();
-		return demo;
-	}
+	// Copy the background, objects and simulation setting of another engine into this engine's world.
+	// The collision shapes are shared with the source engine, so the source engine must outlive this copy.
+	// The copy keeps its own world thread count.
+	void mirrorWorldFrom(const PhysicsEngine &source);
+	// Put the world into a state that only depends on the input object poses, so the result of a
+	// hypothesis test does not depend on the tests that were run on this engine before.
+	void resetWorldForTest(const std::map<std::string, btTransform> &object_pose_map);
+	// Save the objects state, and optionally the contact points between objects for warm starting the solver.
+	// The checkpoint can be restored to any engine that has the same objects, e.g. a mirrored engine.
+	WorldCheckpoint captureWorldCheckpoint(const bool &include_contact_manifolds = false);
+	// Restore the saved objects state. Objects that are not in the checkpoint are removed from the world.
+	void restoreWorldCheckpoint(const WorldCheckpoint &checkpoint);
+	// The next simulation starts from the accumulated impulses of the matching contact points in the source,
+	// which must hold the contact manifolds, instead of zero impulses. Only the manifolds of the object_ids
+	// are warm started, and the source is dropped after that simulation.
+	void setWarmStartContacts(const WorldCheckpoint &source, const std::set<std::string> &object_ids);
+	void setContactWarmStartParameters(const ContactWarmStartParameters &parameters);
+	// Keep the current contacts for the next test of object_id on this engine
+	void saveTestContacts(const std::string &object_id);
+	// Warm start the next simulation from the contacts saved by the previous test, if it tested the same object.
+	// Returns false if there are no such contacts.
+	bool warmStartFromPreviousTest(const std::string &object_id);
+	std::map<std::string, btTransform> getBestTestPoseMap() const;
 
 private:
+	void initPhysics();
+	void exitPhysics();
+	// create the dispatcher, the solver and the world for world_thread_count_ threads
+	void createDynamicsWorld();
+	void deleteDynamicsWorld();
+	void createBroadphase();
+	// replace the broadphase of an empty world
+	void rebuildBroadphase();
+	// rebuild the axis sweep broadphase for the bounds of a new background
+	void fitBroadphaseToBackground(const btVector3 &aabb_min, const btVector3 &aabb_max);
+	void resetWorldLocalTime();
+	void solveWorldContactsWithoutIntegration(const btScalar &time_step);
+	// support graph and stability penalty of the current contacts and cached accelerations
+	void evaluateSceneGraph(const btScalar &timeStep);
 	void simulate();
 	bool checkSteadyState();
 	void cacheObjectVelocities(const btScalar &timeStep);
 	void stopAllObjectMotion();
+	void startQuasiStaticSettling();
+	// turn the object velocities along their net forces, and adapt the pseudo time step of the next tick
+	void relaxQuasiStaticVelocities(const btScalar &timeStep);
 	void applyDataForces();
+	bool checkObjectsSettled(const btScalar &timeStep) const;
+	void updateConvergenceStatus(const bool &objects_settled);
+	btScalar getMaxPenetrationDepth() const;
+	// copy the impulses of the warm start source to the current contacts, then drop the source
+	void applyWarmStartContacts();
+	void startAdaptiveTimestep();
+	// move the dynamic objects out of their overlaps, and record the penetration they started with
+	void depenetrateObjects();
+	// the objects were placed at new poses, measure their penetration again in the next simulation
+	void resetInitialPenetration();
+	void updateAdaptiveTimestep();
 	void makeStatic(btRigidBody &object, const bool &make_static);
+	btRigidBody* cloneRigidBody(const btRigidBody &source_body);
+	void removeBackground();
+	// permanently remove the objects that were missing from more than object_eviction_frames_ addObjects calls,
+	// and that are not referenced
+	void evictMissingObjects(const std::set<std::string> &detected_objects, 
+		const std::set<std::string> &referenced_objects);
+	// add the object to the scene, or remove it, following resident_bodies_
+	void enableRigidBody(btRigidBody* object);
+	void disableRigidBody(btRigidBody* object);
+	// use the shape of collision_detail_level_ for the object
+	void setBodyCollisionDetail(btRigidBody* object);
+	// returns 0 if the object has not been added
+	btRigidBody* getRigidBody(const std::string &object_id) const;
+	std::map<std::string, btTransform> collectObjectPoses() const;
+
+	// Run the command now if the world is free, otherwise queue it for the thread that owns the world
+	void runWorldCommand(const boost::function<void ()> &command);
+	void applyPendingCommands();
+	// unlock mtx_ after applying the queued commands and publishing the snapshot of a stepped world
+	void releaseWorld();
+	void publishSnapshot();
+	// fill the back render buffer and swap it to the front, skipped if the renderer is copying the front buffer
+	void publishRenderSnapshot();
+	void changeBestTestPoseCommand(const std::string &object_id, const btTransform &object_pose);
+	void changeBestTestPoseMapCommand(const std::map<std::string, btTransform> &object_best_pose_from_data);
+	void setIgnoreDataForcesCommand(const std::string &object_id, const bool &value);
+	void makeObjectStaticCommand(const std::string &object_id, const bool &make_static);
 	
 	bool debug_messages_;
 	bool have_background_;
 	bool use_background_normal_as_gravity_;
 	bool rendering_launched_;
-	bool in_simulation_;
+	// read without the world lock by the readers from other threads
+	boost::atomic<bool> in_simulation_;
 	bool enable_data_forces_;
 	unsigned int world_tick_counter_;
 
 	// rigid body data from ObjectWithID input with ID information
-	std::map<std::string, btRigidBody*> rigid_body_;
+	ObjectBodyTable object_table_;
+	// every body of this engine, including the background, is constructed from the pool
+	RigidBodyPool body_pool_;
+	unsigned int object_eviction_frames_;
+	bool resident_bodies_;
+
+	BroadphaseType broadphase_type_;
+	btScalar broadphase_workspace_margin_;
+	btVector3 broadphase_aabb_min_, broadphase_aabb_max_;
+	int collision_detail_level_;
+	bool obb_pair_culling_;
 	std::map<std::string, btTransform> object_best_pose_from_data_;
 
 	std::map<btRigidBody*, MassProp> object_original_mass_prop_;
-	std::map<std::string, bool> object_original_data_forces_flag_;
 
 	// std::map<std::string, btTransform> object_test_pose_map_;
 	std::map<std::string, btTransform> object_best_test_pose_map_;
 
-	std::map<std::string, bool> ignored_data_forces_;
-
 	btRigidBody* background_;
 	btVector3 background_surface_normal_;
 
@@ -163,26 +629,41 @@ private:
 	btBroadphaseInterface* m_broadphase;
 	btDefaultCollisionConfiguration* m_collisionConfiguration;
 	btCollisionDispatcher* m_dispatcher;
-	btSequentialImpulseConstraintSolver* m_solver;
-	// DO NOT DECLARE m_dynamicworld here. It will break OPENGL simulation
+	btConstraintSolver* m_solver;
+	// solver for the large islands of the task scheduler world, 0 for the single threaded world
+	btConstraintSolver* m_solver_mt_;
+	btDynamicsWorld* m_dynamicsWorld;
+	unsigned int world_thread_count_;
 	btAlignedObjectArray<btCollisionShape*> m_collisionShapes;
 	
-	std::map<std::string, ObjectPenaltyParameters> object_penalty_parameter_database_by_id_;
 	std::map<std::string, ObjectPenaltyParameters> * object_penalty_parameter_database_;
-	std::map<std::string, std::string> object_label_class_map_;
 	
 	double gravity_magnitude_;
 	btVector3 gravity_vector_;
 	btVector3 gravity_unit_vector_;
 	
-	std::map<std::string, MovementComponent> object_velocity_;
-	std::map<std::string, MovementComponent> object_acceleration_;
 	SceneSupportGraph scene_graph_;
 	std::map<std::string, vertex_t> vertex_map_;
 
 	btVector3 camera_coordinate_, target_coordinate_;
 	double simulation_step_, fixed_step_;
+	// The simulating thread holds mtx_ for a whole simulation call, so the world tick path takes no lock.
+	// Changes from other threads during a simulation are queued and applied between the world ticks,
+	// and readers from other threads get the snapshot of the last simulation.
 	boost::mutex mtx_;
+	boost::mutex command_mtx_;
+	std::deque<boost::function<void ()> > pending_commands_;
+	boost::atomic<bool> commands_pending_;
+	bool world_stepped_;
+	boost::shared_ptr<const PhysicsEngineSnapshot> snapshot_;
+
+	// double buffered render poses, the back buffer is only touched by the thread that owns the world
+	PhysicsEngineRenderSnapshot render_buffers_[2];
+	int render_front_;
+	unsigned long render_version_;
+	boost::mutex render_mtx_;
+	boost::posix_time::time_duration render_publish_period_;
+	boost::posix_time::ptime last_render_publish_;
 
 	bool reset_obj_vel_every_frame_;
 	bool reset_interaction_forces_every_frame_;
@@ -192,6 +673,42 @@ private:
 
 	double best_scene_probability_;
 	FeedbackDataForcesGenerator * data_forces_generator_;
+
+	ConvergenceCriteria convergence_criteria_;
+	bool check_convergence_;
+	bool simulation_converged_;
+	unsigned int settled_tick_counter_;
+	btScalar data_forces_magnitude_, previous_data_forces_magnitude_;
+
+	QuasiStaticParameters quasi_static_parameters_;
+	bool quasi_static_settling_;
+	bool contact_only_scene_graph_;
+	// true while a settling simulation uses the quasi-static relaxation
+	bool quasi_static_active_;
+	btScalar quasi_static_step_, quasi_static_mixing_;
+	unsigned int quasi_static_positive_ticks_;
+
+	AdaptiveTimestepParameters adaptive_timestep_parameters_;
+	bool adaptive_timestep_;
+	// true while a settling simulation uses the adaptive time step
+	bool adaptive_timestep_active_;
+	btScalar adaptive_step_, adaptive_previous_data_forces_magnitude_;
+	unsigned int adaptive_calm_ticks_;
+
+	DepenetrationParameters depenetration_parameters_;
+	bool depenetration_prepass_;
+	// true from addObjects or restoreWorldCheckpoint until the next simulation
+	bool depenetration_pending_;
+
+	// size of the previous internal step, for the velocity change when the step varies
+	btScalar previous_tick_step_;
+	TimestepStatistics timestep_statistics_;
+
+	ContactWarmStartParameters contact_warm_start_parameters_;
+	WorldCheckpoint warm_start_contacts_;
+	std::set<std::string> warm_start_object_ids_;
+	WorldCheckpoint previous_test_contacts_;
+	std::string previous_test_object_id_;
 };
 
 struct OverlappingObjectSensor : public btCollisionWorld::ContactResultCallback
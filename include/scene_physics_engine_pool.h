@@ -0,0 +1,45 @@
+#ifndef SCENE_PHYSICS_ENGINE_POOL_H
+#define SCENE_PHYSICS_ENGINE_POOL_H
+
+#include <iostream>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+
+#include "scene_physics_engine.h"
+
+// A set of worker physics engines that mirror the world of a source engine.
+// Jobs are distributed over one thread per worker, and each job has exclusive access to its worker.
+class PhysicsEnginePool
+{
+public:
+	typedef boost::function<void (PhysicsEngine&, const std::size_t&)> PhysicsEngineJob;
+
+	PhysicsEnginePool() : debug_messages_(false), number_of_workers_(1), next_job_index_(0) {}
+	~PhysicsEnginePool();
+
+	void setNumberOfWorkers(const std::size_t &number_of_workers);
+	std::size_t getNumberOfWorkers() const;
+	void setDebugMode(bool debug);
+
+	// copy the objects and setting of the source engine into all workers
+	void synchronizeWorkers(const PhysicsEngine &source);
+
+	// run job(worker, job_index) for every job_index in [0, number_of_jobs), returns when all jobs are done
+	void runJobs(const std::size_t &number_of_jobs, const PhysicsEngineJob &job);
+
+private:
+	void workerThread(PhysicsEngine *worker, const std::size_t number_of_jobs, const PhysicsEngineJob *job);
+	bool getNextJobIndex(const std::size_t &number_of_jobs, std::size_t &job_index);
+	void deleteWorkers();
+
+	bool debug_messages_;
+	std::size_t number_of_workers_;
+	std::vector<PhysicsEngine*> workers_;
+
+	std::size_t next_job_index_;
+	boost::mutex job_mtx_;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SCENE_PHYSICS_ENGINE_RENDERER_H
+#define SCENE_PHYSICS_ENGINE_RENDERER_H
+
+// Rendering platform
+#ifdef _WINDOWS
+#include "debugdrawer/Win32DemoApplication.h"
+#define PlatformDemoApplication Win32DemoApplication
+#else
+#include "debugdrawer/GlutDemoApplication.h"
+#define PlatformDemoApplication GlutDemoApplication
+#endif
+
+#include "debugdrawer/GlutStuff.h"
+#include "debugdrawer/GLDebugDrawer.h"
+
+#include "scene_physics_engine.h"
+
+// Optional OpenGL view of a PhysicsEngine world. The renderer draws its own copy of the world collision
+// objects from the poses that the engine publishes, at a capped frame rate, so the engine simulation
+// never waits for the display. The collision shapes are shared, so the engine must outlive the renderer.
+class PhysicsEngineRenderer : public PlatformDemoApplication
+{
+public:
+	PhysicsEngineRenderer(PhysicsEngine *physics_engine, const double &maximum_frame_rate = 30.);
+	virtual ~PhysicsEngineRenderer();
+
+	GLDebugDrawer gDebugDraw;
+
+	void initPhysics();
+
+	virtual void clientMoveAndDisplay();
+
+	virtual void displayCallback();
+	virtual void clientResetScene();
+
+	virtual void setCameraClippingPlaneNearFar(btScalar near, btScalar far = 10000.f);
+	virtual void setCameraPositionAndTarget(btVector3 cam_position, btVector3 cam_target);
+
+	void setMaximumFrameRate(const double &maximum_frame_rate);
+
+private:
+	void updateCameraFromEngine();
+	// move the display objects to the latest poses published by the engine
+	void updateObjectsFromEngine();
+	void waitForNextFrame();
+
+	PhysicsEngine *physics_engine_;
+	btVector3 camera_coordinate_, target_coordinate_;
+
+	// display world, it is never stepped
+	btBroadphaseInterface* m_broadphase;
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btSequentialImpulseConstraintSolver* m_solver;
+	std::map<std::string, btCollisionObject*> display_objects_;
+
+	PhysicsEngineRenderSnapshot snapshot_;
+	boost::posix_time::time_duration frame_period_;
+	boost::posix_time::ptime last_frame_time_;
+};
+
+#endif
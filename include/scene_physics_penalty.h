@@ -2,6 +2,7 @@
 #define SCENE_PHYSICS_PENALTY_H
 
 #include <vector>
+#include <algorithm>
 #include <cmath>
 
 #include <btBulletDynamicsCommon.h>
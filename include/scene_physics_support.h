@@ -22,6 +22,8 @@ struct scene_support_vertex_properties
     btTransform object_pose_;
     double support_contributions_;
     double penetration_distance_;
+    // penetration before the depenetration pre-pass of the simulation
+    double initial_penetration_distance_;
     double colliding_volume_;
     bool ground_supported_;
     double stability_penalty_;
@@ -32,6 +34,7 @@ struct scene_support_vertex_properties
     	collision_object_(NULL),
     	support_contributions_(1.),
     	penetration_distance_(0.),
+        initial_penetration_distance_(0.),
         colliding_volume_(0.),
     	ground_supported_(false),
         stability_penalty_(0),
@@ -122,6 +125,23 @@ std::vector<std::string> getAssociatedIdFromVertexVector( SceneSupportGraph &inp
 
 void assignAllConnectedToParentVertices(SceneSupportGraph &input_graph, const vertex_t &parent_vertex);
 
+// Group the objects into components that are connected by support edges, or whose bounding boxes are within
+// the margin of each other. The background vertex does not connect the components.
+std::map<std::string, std::size_t> getSceneGraphComponents(const SceneSupportGraph &input_graph,
+    const std::map<std::string, vertex_t> &vertex_map, const btScalar &aabb_margin);
+
+// Objects that the simulation of an object can move: its support ancestors, its descendants and its contact
+// neighbors, i.e. the objects with a support edge to it or whose bounding boxes are within the margin of it.
+// The result includes the object itself, but never the background. It is empty if the object is not in the graph.
+std::set<std::string> getObjectInfluenceRegion(const SceneSupportGraph &input_graph,
+    const std::map<std::string, vertex_t> &vertex_map, const std::string &object_id, const btScalar &aabb_margin);
+
+// Objects whose bounding boxes are within the margin of the bounding box of the object placed at any of the poses.
+// The result never includes the object itself or the background.
+std::set<std::string> getObjectsOverlappingPoses(const SceneSupportGraph &input_graph,
+    const std::map<std::string, vertex_t> &vertex_map, const std::string &object_id,
+    const std::vector<btTransform> &object_poses, const btScalar &aabb_margin);
+
 btAABB getCollisionAABB(const btCollisionObject* obj, const btManifoldPoint &pt, const bool &is_body_0, int &shape_index);
 
 double getBoundingBoxVolume(const btAABB &shapeAABB);
@@ -61,11 +61,38 @@ static bool compare_greater(const SceneHypothesis &lhs, const SceneHypothesis &r
 
 typedef std::vector<SceneHypothesis> OneFrameSceneHypotheses;
 
+// Hypotheses of an object that are simulated, and the ones that are pruned without simulation
+struct ObjectHypothesesEvaluationReport
+{
+	ObjectHypothesesEvaluationReport() : simulated_ticks_(0), estimated_saved_ticks_(0), allocated_ticks_(0) {}
+
+	std::vector<int> tested_hypothesis_id_;
+	std::vector<int> pruned_hypothesis_id_;
+	// scene probability upper bound of the pruned hypotheses
+	std::vector<double> pruned_upper_bound_;
+	// hypotheses that are stopped by the successive halving, and the simulation stage where they are stopped
+	std::vector<int> eliminated_hypothesis_id_;
+	std::vector<int> eliminated_stage_;
+	// hypotheses that are not tested because the simulation budget or the deadline was reached
+	std::vector<int> skipped_hypothesis_id_;
+
+	unsigned int simulated_ticks_;
+	// ticks that the stopped hypotheses would have needed to finish the simulation
+	unsigned int estimated_saved_ticks_;
+	// share of the frame simulation budget given to the object, 0 if there is no budget
+	unsigned int allocated_ticks_;
+};
+
 struct SceneObservation
 {
 	SceneHypothesis best_scene_hypothesis_;
 	OneFrameSceneHypotheses scene_hypotheses_list_;
 	std::map<std::string, std::string> object_label_class_map_;
+	std::map<std::string, ObjectHypothesesEvaluationReport> hypotheses_evaluation_report_;
+	// final scene of every beam that survived the beam search, the best one first
+	OneFrameSceneHypotheses beam_scene_hypotheses_;
+	// false for objects whose hypotheses evaluation was cut short by the evaluation deadline
+	std::map<std::string, bool> object_fully_evaluated_;
 	bool is_empty;
 
 	SceneObservation(const SceneHypothesis &final_scene_hypothesis,
@@ -113,6 +140,8 @@ struct AdditionalHypotheses
 {
 	std::string model_name_;
 	std::vector<btTransform> poses_;
+	// data confidence of every pose, filled when the hypotheses are deduplicated
+	std::vector<double> data_confidences_;
 	int object_action_;
 	AdditionalHypotheses(const std::string &model_name,
 		const std::vector<btTransform> &poses, const int &object_action) : 
@@ -151,6 +180,9 @@ public:
 
 	void setStaticObjectThreshold(const double &translation_meter, const double &rotation_degree);
 
+	// maximum number of unique previous hypotheses added to the objects with this action
+	void setNumberOfHypothesesToAdd(const int &scene_change_mode, const int &number_of_hypotheses);
+
 	void setCameraMatrix(const double &fx, const double &fy, const double &cx, const double &cy);
 
 	void setSceneData(pcl::PointCloud<pcl::PointXYZ>::Ptr scene_point_cloud);
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <utility>
+#include <algorithm>
 
 // For plane segmentation
 #include <pcl/ModelCoefficients.h>
@@ -31,13 +32,113 @@
 #include "typedef.h"
 
 #include "scene_physics_engine.h"
+#include "scene_physics_engine_pool.h"
 #include "scene_data_forces.h"
 #include "sequential_scene_hypothesis.h"
 
+// Simulation passes of a hypothesis test: evaluation right after the hypothesis is placed, evaluation after the
+// scene settles, and evaluation after the child objects are added back.
+enum HypothesisTestPass
+{
+	PLACED_HYPOTHESIS_PASS,
+	SETTLED_HYPOTHESIS_PASS,
+	CHILD_OBJECTS_PASS,
+	NUMBER_OF_TEST_PASSES
+};
+
+// One object pose hypothesis to be tested on a physics engine worker
+struct ObjectHypothesisTest
+{
+	ObjectHypothesisTest() : beam_idx_(0), first_pass_(PLACED_HYPOTHESIS_PASS), last_pass_(NUMBER_OF_TEST_PASSES) {}
+
+	std::string object_label_;
+	std::string object_model_name_;
+	int object_action_;
+	std::size_t hypothesis_idx_;
+	btTransform object_pose_hypothesis_;
+	// index of the scene beam that the hypothesis is tested on
+	std::size_t beam_idx_;
+	// the test passes [first_pass_, last_pass_) are simulated in one simulation stage
+	std::size_t first_pass_;
+	std::size_t last_pass_;
+};
+
+// Objects that the tests of one object add back or leave dynamic, shared by all tests of the object
+struct ObjectTestScope
+{
+	// children of the object, added back in the CHILD_OBJECTS_PASS
+	map_string_transform child_pose_map_;
+	// objects that stay dynamic while the others are static, empty if no object is frozen
+	std::set<std::string> influence_region_;
+	// last evaluated probability of the objects that are left out of the tests or may be frozen, on every beam
+	std::vector< std::map<std::string, double> > outside_object_probabilities_;
+};
+
+struct ObjectHypothesisTestResult
+{
+	ObjectHypothesisTestResult() : number_of_ticks_(0) {}
+
+	// probability of all objects in the scene after every evaluation of the test, and the evaluation log
+	std::vector< std::vector<double> > object_probabilities_;
+	std::vector<std::string> evaluation_log_;
+
+	btTransform object_pose_;
+	std::map<std::string, btTransform> object_pose_from_graph_;
+	SceneSupportGraph scene_support_graph_;
+	std::map<std::string, vertex_t> vertex_map_;
+	// probability of the objects that are simulated in the test after the last evaluation
+	std::map<std::string, double> object_probability_map_;
+	unsigned int number_of_ticks_;
+
+	// state of the test between simulation stages
+	FeedbackDataForcesGenerator data_forces_generator_;
+	WorldCheckpoint stage_checkpoint_;
+};
+
+// Partial scene configuration of the objects that have been evaluated, kept by the beam search
+struct SceneBeam
+{
+	SceneBeam() : scene_probability_(1.) {}
+
+	map_string_transform best_test_pose_map_;
+	std::map<std::string, bool> object_background_support_status_;
+	std::map<std::string, int> scene_object_hypothesis_id_;
+	// last evaluated probability of every object, used for the objects that are left out of a test
+	std::map<std::string, double> object_probabilities_;
+	// each beam keeps its own cached icp results, since they depend on the selected object poses
+	FeedbackDataForcesGenerator data_forces_generator_;
+	double scene_probability_;
+};
+
+// Tested object hypothesis that may extend one of the scene beams
+struct SceneBeamCandidate
+{
+	std::size_t test_idx_;
+	std::size_t beam_idx_;
+	std::size_t hypothesis_idx_;
+	btTransform object_pose_;
+	bool background_support_status_;
+	double scene_probability_;
+};
+
+// background supported candidates come first, then the ones with higher scene probability
+static bool compare_beam_candidate(const SceneBeamCandidate &lhs, const SceneBeamCandidate &rhs)
+{
+	if (lhs.background_support_status_ != rhs.background_support_status_) return lhs.background_support_status_;
+	return lhs.scene_probability_ > rhs.scene_probability_;
+}
+
 class SceneHypothesisAssessor
 {
 public:
-	SceneHypothesisAssessor() : physics_engine_ready_(false), best_hypothesis_only_(false) {};
+	SceneHypothesisAssessor() : best_hypothesis_only_(false), physics_engine_ready_(false),
+		stop_simulation_at_convergence_(false), hypothesis_pruning_(true),
+		static_object_hypothesis_limit_(5), object_hypothesis_limit_(15), min_hypothesis_confidence_ratio_(0.5),
+		scene_beam_width_(1), max_duplicate_hypothesis_translation_(0.005),
+		max_duplicate_hypothesis_rotation_(5. * boost::math::constants::pi<double>()/180.),
+		evaluation_deadline_(0.), separate_support_components_(false), freeze_outside_influence_region_(false),
+		contact_warm_starting_(false), early_ranking_collision_detail_(COLLISION_DETAIL_FULL),
+		hypothesis_simulation_budget_(0) {};
 	// SceneHypothesisAssessor(ImagePtr input, ImagePtr background_image);
 	
 	// set physics engine environment to be used.
@@ -51,6 +152,65 @@ public:
 	std::map<std::string, ObjectParameter> getCorrectedObjectTransform(const bool &include_prev_observation = false);
 	std::map<std::string, ObjectParameter> getCorrectedObjectTransformFromSceneGraph();
 	void setDebug(bool debug);
+	// number of physics engine workers that evaluate the object hypotheses in parallel
+	void setNumberOfEvaluationThreads(const std::size_t &number_of_threads);
+	// end each simulation window as soon as the objects settle, instead of always simulating the full window
+	void setStopSimulationAtConvergence(const bool &flag);
+	// Skip hypotheses whose scene probability upper bound can not beat the best tested hypotheses of the object.
+	// The bound is the probability of the objects that are left out of the tests, since the simulated objects
+	// may reach any probability up to 1.
+	void setHypothesisPruning(const bool &flag);
+	// Only test the first hypotheses of every object: stop after more than the limit of hypotheses for static
+	// objects and for the other objects, and skip the hypotheses with a data confidence below the ratio of the
+	// confidence of the first hypothesis. A limit or ratio of 0 or less disables it.
+	void setHypothesisCandidateLimits(const int &static_object_limit, const int &object_limit, 
+		const double &min_confidence_ratio);
+	// Number of partial scene configurations kept while evaluating the objects one by one. 
+	// The default of 1 keeps only the best pose of every evaluated object.
+	void setSceneBeamWidth(const std::size_t &beam_width);
+	// Object pose hypotheses closer than these thresholds, after accounting for the object symmetry,
+	// are merged before the evaluation. The hypothesis with the best data confidence is kept.
+	void setHypothesisDeduplicationThreshold(const double &translation_meter, const double &rotation_degree);
+	// Merge the poses in the world frame that are closer than the thresholds to the first member of a cluster,
+	// in meter and radian. The pose with the best data confidence of every cluster is kept, in the order of
+	// the first member of the cluster.
+	static void mergeDuplicatePoses(const std::vector<btTransform> &poses, const std::vector<double> &data_confidences,
+		const std::string &model_name, const std::map<std::string, ObjectSymmetry> &object_symmetry_map,
+		const double &max_translation, const double &max_rotation,
+		std::vector<btTransform> &merged_poses, std::vector<double> &merged_confidences);
+	// angle between the two rotations, after accounting for the symmetry of the model
+	static double getSymmetricRotationDistance(const btQuaternion &lhs, const btQuaternion &rhs,
+		const std::string &model_name, const std::map<std::string, ObjectSymmetry> &object_symmetry_map);
+	// Simulate the hypotheses of objects with this action in stages, one stage for every test pass. Only 
+	// promotion_fractions[i] of the hypotheses with the best scene probability continue after stage i.
+	// The default of no fractions simulates every hypothesis fully.
+	void setHypothesisSimulationSchedule(const int &object_action, const std::vector<double> &promotion_fractions);
+	// Stop evaluating the hypotheses after this many seconds and keep the best scene found so far.
+	// A deadline of 0 or less evaluates all hypotheses.
+	void setEvaluationDeadline(const double &deadline_second);
+	// Only simulate the support graph component of the tested object in each hypothesis test. The objects in
+	// the other components keep their last evaluated probability.
+	void setSeparateSupportComponents(const bool &flag);
+	// Make the objects outside the influence region of the tested object static in each hypothesis test.
+	// The region is the support ancestors, descendants and contact neighbors of the object in the scene graph.
+	// The frozen objects keep their last evaluated probability.
+	void setFreezeOutsideInfluenceRegion(const bool &flag);
+	// Start the contact solver from the impulses of the previous test of the same object, and start the static
+	// and support retained objects from the impulses of the previous frame. The tests are only warm started
+	// with a single worker, since the previous test of a worker depends on the order the workers take the jobs.
+	void setContactWarmStarting(const bool &flag);
+	// Collision detail level of the hypothesis test stages that only rank the hypotheses for the promotion
+	// to the next stage, one of CollisionDetailLevel. The last stage always uses the full shapes.
+	void setEarlyRankingCollisionDetail(const int &detail_level);
+	// Simulation ticks that all hypotheses tests of a frame may use. The budget is divided over the objects
+	// by their uncertainty, and the unused ticks of an object go to the following objects. 0 disables the budget.
+	void setHypothesisSimulationBudget(const unsigned int &simulation_ticks);
+	// maximum number of hypotheses from the previous frames that are added to the objects with this action
+	void setNumberOfPreviousHypotheses(const int &object_action, const int &number_of_hypotheses);
+	// whether the hypotheses of every object in the last evaluated frame were evaluated before the deadline
+	std::map<std::string, bool> getObjectEvaluationStatus() const;
+	// tested and pruned hypotheses of every object in the last evaluated frame
+	std::map<std::string, ObjectHypothesesEvaluationReport> getHypothesesEvaluationReport() const;
 	
 	void setObjectHypothesesMap(std::map<std::string, ObjectHypothesesData > &object_hypotheses_map);
 	void evaluateAllObjectHypothesisProbability();
@@ -80,12 +240,53 @@ public:
 private:
 	void getCurrentSceneSupportGraph();
 	void getUpdatedSceneSupportGraph();
+	unsigned int settleSimulation(PhysicsEngine &physics_engine, const double &delta_time, 
+		const double &simulation_step, const bool &data_forces_enabled = true) const;
 	double evaluateObjectProbability(const std::string &object_label, 
 		const std::string &object_model_name, const int &object_action,
 		const bool &verbose = false);
-	double evaluateSceneOnObjectHypothesis(std::map<std::string, btTransform> &object_pose_from_graph, 
-		const std::string &object_label, const std::string &object_model_name, bool &background_support_status,
-		const btTransform &object_pose_hypothesis, const int &object_action,const bool &reset_position);
+	double evaluateObjectProbability(const SceneSupportGraph &scene_support_graph,
+		const std::map<std::string, vertex_t> &vertex_map, FeedbackDataForcesGenerator &data_forces_generator,
+		const btVector3 &gravity_direction, const std::string &object_label, 
+		const std::string &object_model_name, const int &object_action,
+		const bool &verbose, std::ostream &verbose_output) const;
+	std::vector<double> evaluateSceneOnObjectHypothesis(PhysicsEngine &physics_engine,
+		FeedbackDataForcesGenerator &data_forces_generator, ObjectHypothesisTestResult &test_result,
+		const std::string &object_label, const btTransform &object_pose_hypothesis, 
+		const int &object_action, const bool &reset_position, 
+		const std::map<std::string, double> &outside_object_probabilities, const std::set<std::string> &frozen_objects,
+		std::ostream &verbose_output) const;
+	void settleWorldForTest(PhysicsEngine &physics_engine, const std::size_t &beam_idx,
+		const std::vector<SceneBeam> &beams, const std::vector<map_string_transform> &beam_test_pose_maps,
+		std::vector<WorldCheckpoint> &settled_worlds, std::vector<unsigned int> &settle_ticks) const;
+	map_string_transform getComponentPoseMap(const map_string_transform &object_pose_map, 
+		const std::string &object_label, const std::map<std::string, std::size_t> &object_component_map,
+		const std::set<std::string> &merged_objects) const;
+	void testObjectHypothesis(PhysicsEngine &physics_engine, const std::size_t &job_idx,
+		const std::vector<std::size_t> &test_indices, const std::vector<ObjectHypothesisTest> &hypothesis_tests, 
+		const std::vector<SceneBeam> &beams, const std::vector<WorldCheckpoint> &settled_worlds, 
+		const ObjectTestScope &test_scope, std::vector<ObjectHypothesisTestResult> &test_results) const;
+	std::set<std::string> freezeObjectsOutsideRegion(PhysicsEngine &physics_engine, 
+		const std::set<std::string> &influence_region, const std::string &object_label) const;
+	void unfreezeObjects(PhysicsEngine &physics_engine, const std::set<std::string> &frozen_objects) const;
+	void evaluateSceneBeam(PhysicsEngine &physics_engine, const std::size_t &beam_idx,
+		const std::vector<SceneBeam> &beams, const std::map<std::string, int> &object_action_map,
+		std::vector<ObjectHypothesisTestResult> &beam_results) const;
+	void deduplicateObjectHypotheses(std::map<std::string, AdditionalHypotheses> &object_hypotheses);
+	void updateMissingCachedIcpResult(FeedbackDataForcesGenerator &data_forces_generator, 
+		const map_string_transform &object_pose_map) const;
+	std::vector<double> getHypothesisPromotionFractions(const int &object_action) const;
+	bool checkEvaluationDeadlineReached() const;
+	double getObjectSimulationBudgetWeight(const AdditionalHypotheses &object_hypotheses, 
+		const std::size_t &support_depth) const;
+	static unsigned int getNumberOfSimulatedTicks(const std::vector<ObjectHypothesisTestResult> &test_results);
+	void limitObjectHypotheses(std::map<std::string, AdditionalHypotheses> &object_hypotheses) const;
+	static double getSceneProbabilityUpperBound(const std::map<std::string, double> &left_out_object_probabilities);
+	// true if the beams are already filled with candidates that are at least as good as the upper bound
+	bool checkHypothesisPruned(const double &upper_bound, const bool &background_support_status,
+		const std::vector<SceneBeamCandidate> &beam_candidates) const;
+	static double composeSceneProbability(const std::vector<double> &object_probabilities,
+		bool &background_support_status);
 	double evaluateSceneProbabilityFromGraph(const std::map<std::string, int> &object_action_map);
 	void getSceneSupportGraphFromCurrentObjects(
 		std::map<std::string, bool> &object_background_support_status,
@@ -99,8 +300,28 @@ private:
 	bool debug_messages_;
 	bool physics_engine_ready_;
 	bool include_prev_observation_;
+	bool stop_simulation_at_convergence_;
+	bool hypothesis_pruning_;
+	int static_object_hypothesis_limit_;
+	int object_hypothesis_limit_;
+	double min_hypothesis_confidence_ratio_;
+	std::size_t scene_beam_width_;
+	double max_duplicate_hypothesis_translation_;
+	double max_duplicate_hypothesis_rotation_;
+	std::map<int, std::vector<double> > hypothesis_promotion_fractions_;
+	double evaluation_deadline_;
+	bool separate_support_components_;
+	bool freeze_outside_influence_region_;
+	bool contact_warm_starting_;
+	// contacts of the final scene of the previous frame, and the objects of this frame that may use them
+	WorldCheckpoint previous_frame_contacts_;
+	std::set<std::string> frame_warm_start_objects_;
+	int early_ranking_collision_detail_;
+	unsigned int hypothesis_simulation_budget_;
+	boost::posix_time::ptime evaluation_start_time_;
 
 	PhysicsEngine * physics_engine_;
+	PhysicsEnginePool physics_engine_pool_;
 	SceneSupportGraph scene_support_graph_;
 	FeedbackDataForcesGenerator data_forces_generator_;
 
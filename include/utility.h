@@ -128,6 +128,13 @@ std::string getObjectIDFromCollisionObject(const btCollisionObject* object)
         return std::string("unrecognized_object");
 }
 
+// a disabled object stays in the world but takes no part in the simulation
+static
+bool isCollisionObjectEnabled(const btCollisionObject* object)
+{
+    return object->getBroadphaseHandle() != NULL && object->getActivationState() != DISABLE_SIMULATION;
+}
+
 static
 std::string printTransform(const btTransform &transform)
 {
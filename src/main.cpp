@@ -26,8 +26,8 @@ int main(int argc, char* argv[])
 {
 #if 0
     PhysicsEngine test;
-    // test.initPhysics();
-    return glutmain(argc,argv, 1024,600,"Test",&test);
+    PhysicsEngineRenderer renderer(&test);
+    return glutmain(argc,argv, 1024,600,"Test",&renderer);
 #else
     ros::init(argc,argv, "scene_graph_test");
     ros::NodeHandle nh ("~");
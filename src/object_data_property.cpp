@@ -35,7 +35,9 @@ void Object::setPhysicalProperties(const objectShapePtr mesh, const PhysicalProp
 
 	this->physical_data_ready_ = true;
 
-	this->computeObb();
+	// the levels of a previous mesh belong to that mesh
+	this->detail_shapes_ = NULL;
+	if (this->computeObb()) this->generateCollisionDetailShapes();
 }
 
 void Object::shallowCopyPhysicalProperties(objectShapePtr &mesh_out, PhysicalProperties &physical_properties_out) const
@@ -50,20 +52,37 @@ btRigidBody* Object::generateRigidBody(const btTransform &transform) const
 	btDefaultMotionState* object_motion_state = 
 		new btDefaultMotionState(transform);
 
-	btRigidBody::btRigidBodyConstructionInfo object_RigidBodyCI(this->physical_properties_.mass_, 
-		object_motion_state, this->mesh_, this->physical_properties_.inertia_);
-
-	btRigidBody* object_RigidBody = new btRigidBody(object_RigidBodyCI);
-	object_RigidBody->setFriction(this->physical_properties_.friction_);
-	object_RigidBody->setRollingFriction(this->physical_properties_.rolling_friction_);
-	object_RigidBody->setDamping(0.5,0.5);
+	btRigidBody* object_RigidBody = new btRigidBody(this->getRigidBodyConstructionInfo(object_motion_state));
 	return object_RigidBody;
 }
 
+btRigidBody::btRigidBodyConstructionInfo Object::getRigidBodyConstructionInfo(btMotionState* motion_state) const
+{
+	btRigidBody::btRigidBodyConstructionInfo object_RigidBodyCI(this->physical_properties_.mass_, 
+		motion_state, this->mesh_, this->physical_properties_.inertia_);
+	object_RigidBodyCI.m_friction = this->physical_properties_.friction_;
+	object_RigidBodyCI.m_rollingFriction = this->physical_properties_.rolling_friction_;
+	object_RigidBodyCI.m_linearDamping = 0.5;
+	object_RigidBodyCI.m_angularDamping = 0.5;
+	return object_RigidBodyCI;
+}
+
 void Object::deleteMeshContent()
 {
 	if (this->mesh_ != NULL)
 		delete this->mesh_;
+	if (this->detail_shapes_ != NULL)
+	{
+		// the coarse levels own their child shapes, the full level is mesh_
+		for (int level = 0; level < COLLISION_DETAIL_FULL; ++level)
+		{
+			btCompoundShape* level_shape = static_cast<btCompoundShape*>(this->detail_shapes_->shapes_[level]);
+			for (int i = 0; i < level_shape->getNumChildShapes(); ++i) delete level_shape->getChildShape(i);
+			delete level_shape;
+		}
+		delete this->detail_shapes_;
+		this->detail_shapes_ = NULL;
+	}
 }
 
 // Object::~Object()
@@ -84,6 +103,7 @@ void Object::shallowCopy(const Object& other)
 	this->physical_data_ready_ = true;
 	
 	this->copyObbProperty(other);
+	this->detail_shapes_ = other.detail_shapes_;
 }
 
 void Object::deepCopy(const Object& other)
@@ -100,6 +120,9 @@ void Object::deepCopy(const Object& other)
 	this->physical_data_ready_ = true;
 
 	this->copyObbProperty(other);
+	// the copied mesh gets its own detail levels
+	this->detail_shapes_ = NULL;
+	if (other.detail_shapes_ != NULL) this->generateCollisionDetailShapes();
 }
 
 btVector3 Object::getInertiaVector() const
@@ -112,6 +135,111 @@ objectShapePtr Object::getCollisionShape() const
 	return this->mesh_;
 }
 
+objectShapePtr Object::getCollisionShape(const int &detail_level) const
+{
+	if (this->detail_shapes_ == NULL || detail_level < 0 || detail_level >= NUMBER_OF_COLLISION_DETAIL_LEVELS) 
+		return this->mesh_;
+	return this->detail_shapes_->shapes_[detail_level];
+}
+
+bool Object::generateCollisionDetailShapes()
+{
+	if (!mesh_ || !mesh_->isCompound() || this->detail_shapes_ != NULL) return false;
+
+	// like computeObb, the child hulls are in the object frame and unscaled
+	const btCompoundShape* compound_shape = (btCompoundShape*)mesh_;
+	btConvexHullShape all_hull_vertices;
+	btScalar hull_margin = 0;
+	for (int i = 0; i < compound_shape->getNumChildShapes(); ++i)
+	{
+		const btCollisionShape *child = compound_shape->getChildShape(i);
+		if (!child->isConvex()) continue;
+		const btConvexHullShape* child_hull = (btConvexHullShape*)child;
+		const btVector3* points = child_hull->getUnscaledPoints();
+		for (int j = 0; j < child_hull->getNumPoints(); ++j)
+		{
+			all_hull_vertices.addPoint(points[j], false);
+		}
+		hull_margin = std::max(hull_margin, child_hull->getMargin());
+	}
+	if (all_hull_vertices.getNumPoints() < 4) return false;
+	all_hull_vertices.recalcLocalAabb();
+	all_hull_vertices.setMargin(hull_margin);
+
+	const btVector3 &scaling = mesh_->getLocalScaling();
+	btVector3 obb_center = (this->entire_shape_obb_.max_point_ + this->entire_shape_obb_.min_point_) / 2;
+	btVector3 obb_half_extents = (this->entire_shape_obb_.max_point_ - this->entire_shape_obb_.min_point_) / 2;
+	btTransform obb_pose = this->entire_shape_obb_.pose_ * btTransform(btQuaternion::getIdentity(), obb_center);
+
+	this->detail_shapes_ = new CollisionDetailShapes;
+	btCompoundShape* obb_shape = new btCompoundShape();
+	obb_shape->addChildShape(obb_pose, new btBoxShape(obb_half_extents));
+	obb_shape->setLocalScaling(scaling);
+
+	// at most one vertex per sampled direction of btShapeHull
+	btShapeHull simplified_hull(&all_hull_vertices);
+	simplified_hull.buildHull(hull_margin);
+	btConvexHullShape* hull = new btConvexHullShape((const btScalar*)simplified_hull.getVertexPointer(), 
+		simplified_hull.numVertices());
+	hull->setMargin(hull_margin);
+	btCompoundShape* hull_shape = new btCompoundShape();
+	hull_shape->addChildShape(btTransform::getIdentity(), hull);
+	hull_shape->setLocalScaling(scaling);
+
+	this->detail_shapes_->shapes_[COLLISION_DETAIL_OBB] = obb_shape;
+	this->detail_shapes_->shapes_[COLLISION_DETAIL_HULL] = hull_shape;
+	this->detail_shapes_->shapes_[COLLISION_DETAIL_FULL] = mesh_;
+	this->detail_shapes_->obb_pose_ = btTransform(obb_pose.getRotation(), obb_pose.getOrigin() * scaling);
+	this->detail_shapes_->obb_half_extents_ = obb_half_extents * scaling + btVector3(hull_margin, hull_margin, hull_margin);
+	for (int level = 0; level < NUMBER_OF_COLLISION_DETAIL_LEVELS; ++level)
+	{
+		this->detail_shapes_->shapes_[level]->setUserPointer(this->detail_shapes_);
+	}
+	return true;
+}
+
+bool checkObbOverlap(const btTransform &pose_a, const btVector3 &half_extents_a, 
+	const btTransform &pose_b, const btVector3 &half_extents_b, const btScalar &margin)
+{
+	// box b in the frame of box a
+	btVector3 extents_a = half_extents_a + btVector3(margin, margin, margin);
+	const btVector3 &extents_b = half_extents_b;
+	btMatrix3x3 rotation = pose_a.getBasis().transposeTimes(pose_b.getBasis());
+	btVector3 translation = pose_a.invXform(pose_b.getOrigin());
+	btMatrix3x3 abs_rotation = rotation.absolute();
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j) abs_rotation[i][j] += SIMD_EPSILON;
+	}
+
+	// face axes of both boxes
+	for (int i = 0; i < 3; ++i)
+	{
+		if (btFabs(translation[i]) > extents_a[i] + extents_b.dot(abs_rotation[i])) return false;
+	}
+	for (int j = 0; j < 3; ++j)
+	{
+		btScalar radius_a = extents_a[0] * abs_rotation[0][j] + extents_a[1] * abs_rotation[1][j] + extents_a[2] * abs_rotation[2][j];
+		btScalar distance = translation[0] * rotation[0][j] + translation[1] * rotation[1][j] + translation[2] * rotation[2][j];
+		if (btFabs(distance) > radius_a + extents_b[j]) return false;
+	}
+
+	// cross products of the edge directions
+	for (int i = 0; i < 3; ++i)
+	{
+		int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; ++j)
+		{
+			int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+			btScalar radius_a = extents_a[i1] * abs_rotation[i2][j] + extents_a[i2] * abs_rotation[i1][j];
+			btScalar radius_b = extents_b[j1] * abs_rotation[i][j2] + extents_b[j2] * abs_rotation[i][j1];
+			btScalar distance = translation[i2] * rotation[i1][j] - translation[i1] * rotation[i2][j];
+			if (btFabs(distance) > radius_a + radius_b) return false;
+		}
+	}
+	return true;
+}
+
 void Object::getObbProperty(Obb &entire_shape_obb, std::vector<Obb> &child_shape_obb) const
 {
 	entire_shape_obb = this->entire_shape_obb_;
@@ -20,8 +20,11 @@ RosSceneHypothesisAssessor::RosSceneHypothesisAssessor(const ros::NodeHandle &nh
 
 void RosSceneHypothesisAssessor::callGlutMain(int argc, char* argv[])
 {
-	this->physics_engine_.renderingLaunched();
-	glutmain(argc, argv,1024,600,"Scene Parsing Demo",&this->physics_engine_);
+	// the renderer only draws the poses published by the engine, so the frame rate does not slow the simulation
+	double render_fps;
+	this->nh_.param("render_fps",render_fps,30.);
+	PhysicsEngineRenderer renderer(&this->physics_engine_, render_fps);
+	glutmain(argc, argv,1024,600,"Scene Parsing Demo",&renderer);
 }
 
 void RosSceneHypothesisAssessor::exitGlutMain()
@@ -96,6 +99,124 @@ void RosSceneHypothesisAssessor::setNodeHandle(const ros::NodeHandle &nh)
 
 	this->physics_engine_.setGravityFromBackgroundNormal(background_normal_as_gravity_);
 
+	// the world is rebuilt for the thread count, so this is set before the table is loaded
+	int physics_world_threads;
+	nh.param("physics_world_threads",physics_world_threads,1);
+	this->physics_engine_.setWorldThreadCount(physics_world_threads > 0 ? physics_world_threads : 1);
+
+	int broadphase;
+	double broadphase_workspace_margin;
+	nh.param("broadphase",broadphase,int(DBVT_BROADPHASE));
+	nh.param("broadphase_workspace_margin",broadphase_workspace_margin,0.5);
+	this->physics_engine_.setBroadphase(broadphase, broadphase_workspace_margin * SCALING);
+
+	bool obb_pair_culling;
+	nh.param("obb_pair_culling",obb_pair_culling,false);
+	this->physics_engine_.setObbPairCulling(obb_pair_culling);
+
+	int object_eviction_frames;
+	nh.param("object_eviction_frames",object_eviction_frames,0);
+	this->physics_engine_.setObjectEvictionFrames(object_eviction_frames > 0 ? object_eviction_frames : 0);
+
+	bool resident_bodies;
+	nh.param("resident_bodies",resident_bodies,false);
+	this->physics_engine_.setResidentBodies(resident_bodies);
+
+	int evaluation_threads;
+	nh.param("hypothesis_evaluation_threads",evaluation_threads,1);
+	this->setNumberOfEvaluationThreads(evaluation_threads > 0 ? evaluation_threads : 1);
+
+	bool stop_simulation_at_convergence;
+	nh.param("stop_simulation_at_convergence",stop_simulation_at_convergence,false);
+	this->setStopSimulationAtConvergence(stop_simulation_at_convergence);
+
+	bool quasi_static_settling;
+	nh.param("quasi_static_settling",quasi_static_settling,false);
+	this->physics_engine_.setQuasiStaticSettling(quasi_static_settling);
+
+	bool adaptive_timestep;
+	nh.param("adaptive_timestep",adaptive_timestep,false);
+	this->physics_engine_.setAdaptiveTimestep(adaptive_timestep);
+
+	bool depenetration_prepass;
+	nh.param("depenetration_prepass",depenetration_prepass,false);
+	this->physics_engine_.setDepenetrationPrepass(depenetration_prepass);
+
+	bool contact_only_scene_graph;
+	nh.param("contact_only_scene_graph",contact_only_scene_graph,false);
+	this->physics_engine_.setContactOnlySceneGraph(contact_only_scene_graph);
+
+	bool hypothesis_pruning;
+	nh.param("hypothesis_pruning",hypothesis_pruning,true);
+	this->setHypothesisPruning(hypothesis_pruning);
+
+	int static_object_hypothesis_limit, object_hypothesis_limit;
+	double min_hypothesis_confidence_ratio;
+	nh.param("static_object_hypothesis_limit",static_object_hypothesis_limit,5);
+	nh.param("object_hypothesis_limit",object_hypothesis_limit,15);
+	nh.param("min_hypothesis_confidence_ratio",min_hypothesis_confidence_ratio,0.5);
+	this->setHypothesisCandidateLimits(static_object_hypothesis_limit, object_hypothesis_limit, 
+		min_hypothesis_confidence_ratio);
+
+	int scene_beam_width;
+	nh.param("scene_beam_width",scene_beam_width,1);
+	this->setSceneBeamWidth(scene_beam_width > 0 ? scene_beam_width : 1);
+
+	double duplicate_hypothesis_translation, duplicate_hypothesis_rotation;
+	nh.param("duplicate_hypothesis_translation",duplicate_hypothesis_translation,0.005);
+	nh.param("duplicate_hypothesis_rotation",duplicate_hypothesis_rotation,5.0);
+	this->setHypothesisDeduplicationThreshold(duplicate_hypothesis_translation, duplicate_hypothesis_rotation);
+
+	double evaluation_deadline;
+	nh.param("evaluation_deadline",evaluation_deadline,0.0);
+	this->setEvaluationDeadline(evaluation_deadline);
+
+	bool separate_support_components;
+	nh.param("separate_support_components",separate_support_components,false);
+	this->setSeparateSupportComponents(separate_support_components);
+
+	bool freeze_outside_influence_region;
+	nh.param("freeze_outside_influence_region",freeze_outside_influence_region,false);
+	this->setFreezeOutsideInfluenceRegion(freeze_outside_influence_region);
+
+	bool contact_warm_starting;
+	nh.param("contact_warm_starting",contact_warm_starting,false);
+	this->setContactWarmStarting(contact_warm_starting);
+
+	int early_ranking_collision_detail;
+	nh.param("early_ranking_collision_detail",early_ranking_collision_detail,int(COLLISION_DETAIL_FULL));
+	this->setEarlyRankingCollisionDetail(early_ranking_collision_detail);
+
+	int hypothesis_simulation_budget;
+	nh.param("hypothesis_simulation_budget",hypothesis_simulation_budget,0);
+	this->setHypothesisSimulationBudget(hypothesis_simulation_budget > 0 ? hypothesis_simulation_budget : 0);
+
+	// number of hypotheses from the previous frames that are added to the retained objects
+	int perturbed_object_previous_hypotheses, static_object_previous_hypotheses, 
+		support_retained_object_previous_hypotheses;
+	nh.param("perturbed_object_previous_hypotheses",perturbed_object_previous_hypotheses,10);
+	nh.param("static_object_previous_hypotheses",static_object_previous_hypotheses,3);
+	nh.param("support_retained_object_previous_hypotheses",support_retained_object_previous_hypotheses,10);
+	this->setNumberOfPreviousHypotheses(PERTURB_OBJECT, perturbed_object_previous_hypotheses);
+	this->setNumberOfPreviousHypotheses(STATIC_OBJECT, static_object_previous_hypotheses);
+	this->setNumberOfPreviousHypotheses(SUPPORT_RETAINED_OBJECT, support_retained_object_previous_hypotheses);
+
+	// fraction of the hypotheses that continue to the next simulation stage for every object action
+	double add_object_promotion_fraction, perturbed_object_promotion_fraction, static_object_promotion_fraction,
+		support_retained_object_promotion_fraction;
+	nh.param("add_object_promotion_fraction",add_object_promotion_fraction,1.0);
+	nh.param("perturbed_object_promotion_fraction",perturbed_object_promotion_fraction,1.0);
+	nh.param("static_object_promotion_fraction",static_object_promotion_fraction,1.0);
+	nh.param("support_retained_object_promotion_fraction",support_retained_object_promotion_fraction,1.0);
+	this->setHypothesisSimulationSchedule(ADD_OBJECT, 
+		std::vector<double>(NUMBER_OF_TEST_PASSES - 1, add_object_promotion_fraction));
+	this->setHypothesisSimulationSchedule(PERTURB_OBJECT, 
+		std::vector<double>(NUMBER_OF_TEST_PASSES - 1, perturbed_object_promotion_fraction));
+	this->setHypothesisSimulationSchedule(STATIC_OBJECT, 
+		std::vector<double>(NUMBER_OF_TEST_PASSES - 1, static_object_promotion_fraction));
+	this->setHypothesisSimulationSchedule(SUPPORT_RETAINED_OBJECT, 
+		std::vector<double>(NUMBER_OF_TEST_PASSES - 1, support_retained_object_promotion_fraction));
+
 	SCALED_GRAVITY_MAGNITUDE = SCALING * GRAVITY_MAGNITUDE / GRAVITY_SCALE_COMPENSATION;
 
 	if (load_table){
@@ -502,6 +623,23 @@ sequential_scene_parsing::SceneGraph RosSceneHypothesisAssessor::generateSceneGr
 		structure_graph_msg.base_objects_id.push_back(current_graph[*it].object_id_);
 	}
 
+	std::map<std::string, bool> object_evaluation_status = this->getObjectEvaluationStatus();
+	for (std::map<std::string, bool>::const_iterator it = object_evaluation_status.begin(); 
+		it != object_evaluation_status.end(); ++it)
+	{
+		if (!it->second) structure_graph_msg.partially_evaluated_objects.push_back(it->first);
+	}
+	structure_graph_msg.evaluation_complete = structure_graph_msg.partially_evaluated_objects.empty();
+
+	std::map<std::string, ObjectHypothesesEvaluationReport> evaluation_report = this->getHypothesesEvaluationReport();
+	for (std::map<std::string, ObjectHypothesesEvaluationReport>::const_iterator it = evaluation_report.begin(); 
+		it != evaluation_report.end(); ++it)
+	{
+		structure_graph_msg.evaluated_objects.push_back(it->first);
+		structure_graph_msg.simulated_ticks.push_back(it->second.simulated_ticks_);
+		structure_graph_msg.allocated_ticks.push_back(it->second.allocated_ticks_);
+	}
+
 	return structure_graph_msg;
 }
 
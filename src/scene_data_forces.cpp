@@ -76,7 +76,7 @@ void FeedbackDataForcesGenerator::setFeedbackForceMode(int mode)
 	force_data_model_ = mode;
 }
 
-void FeedbackDataForcesGenerator::applyFeedbackForces(btRigidBody &object, const std::string &model_name)
+std::pair<btVector3, btVector3> FeedbackDataForcesGenerator::applyFeedbackForces(btRigidBody &object, const std::string &model_name)
 {
 	if (!this->have_scene_data_)
 	{
@@ -85,7 +85,7 @@ void FeedbackDataForcesGenerator::applyFeedbackForces(btRigidBody &object, const
 	
 	if (percent_gravity_max_correction_ == 0.0)
 	{
-		return;
+		return std::make_pair(btVector3(0.,0.,0.),btVector3(0.,0.,0.));
 	}
 
 	if (keyExistInConstantMap(model_name, model_cloud_map_))
@@ -107,7 +107,9 @@ void FeedbackDataForcesGenerator::applyFeedbackForces(btRigidBody &object, const
 		// std::cerr << *(std::string*)object.getUserPointer() << " gets " << printBtVector3(applied_forces) << "N and " 
 		// 	<< printBtVector3(object.getTotalForce()) << std::endl;
 			// << applied_torque.norm() << " Nm.\n";
+		return std::make_pair(applied_forces, applied_torque);
 	}
+	return std::make_pair(btVector3(0.,0.,0.),btVector3(0.,0.,0.));
 }
 
 std::pair<btVector3, btVector3> FeedbackDataForcesGenerator::applyFeedbackForcesDebug(const btTransform &object_real_pose, const std::string &model_name)
@@ -246,6 +248,19 @@ void FeedbackDataForcesGenerator::manualSetCachedIcpResultMapFromPose(const btTr
 	this->updateCachedIcpResultMap(transformed_object_mesh_cloud, object_id);
 }
 
+void FeedbackDataForcesGenerator::updateMissingCachedIcpResult(const btTransform &object_pose,
+	const std::string &object_id, const std::string &model_name)
+{
+	if (force_data_model_ != CACHED_ICP_CORRESPONDENCE || 
+		keyExistInConstantMap(object_id, model_cloud_icp_result_map_)) return;
+
+	btTransform object_real_pose;
+	PointCloudXYZPtr transformed_object_mesh_cloud = this->getTransformedObjectCloud(object_pose, model_name, object_real_pose);
+
+	PointCloudXYZPtr icp_result = this->doICP(transformed_object_mesh_cloud);
+	this->updateCachedIcpResultMap(icp_result, object_id);
+}
+
 void FeedbackDataForcesGenerator::resetCachedIcpResult()
 {
 	model_cloud_icp_result_map_.clear();
@@ -352,7 +367,11 @@ std::pair<btVector3, btVector3> FeedbackDataForcesGenerator::generateDataForceWi
 
 PointCloudXYZPtr FeedbackDataForcesGenerator::doICP(const PointCloudXYZPtr input_cloud) const
 {
-	pcl::IterativeClosestPoint<pcl::PointXYZ, pcl::PointXYZ> icp = icp_;
+	// copies of icp_ share the internal correspondence estimation, so use a new icp with the same setting
+	pcl::IterativeClosestPoint<pcl::PointXYZ, pcl::PointXYZ> icp;
+	icp.setMaximumIterations(max_icp_iteration_);
+	icp.setTransformationEpsilon(1e-8);
+	icp.setMaxCorrespondenceDistance(2*max_point_distance_threshold_);
 
 	PointCloudXYZPtr cloud_around_initial_estimate(new PointCloudXYZ());
 	pcl::MomentOfInertiaEstimation <pcl::PointXYZ> feature_extractor;
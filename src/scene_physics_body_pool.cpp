@@ -0,0 +1,74 @@
+#include "scene_physics_body_pool.h"
+
+RigidBodyPool::~RigidBodyPool()
+{
+	this->clear();
+}
+
+btRigidBody* RigidBodyPool::acquire(const std::string &object_id, 
+	btRigidBody::btRigidBodyConstructionInfo construction_info, const btTransform &transform)
+{
+	void* motion_state_memory;
+	if (this->free_motion_states_.empty()) motion_state_memory = btAlignedAlloc(sizeof(btDefaultMotionState), 16);
+	else
+	{
+		motion_state_memory = this->free_motion_states_.back();
+		this->free_motion_states_.pop_back();
+	}
+	construction_info.m_motionState = new (motion_state_memory) btDefaultMotionState(transform);
+
+	void* body_memory;
+	if (this->free_bodies_.empty()) body_memory = btAlignedAlloc(sizeof(btRigidBody), 16);
+	else
+	{
+		body_memory = this->free_bodies_.back();
+		this->free_bodies_.pop_back();
+	}
+	btRigidBody* body = new (body_memory) btRigidBody(construction_info);
+
+	std::string* object_name;
+	if (this->free_names_.empty()) object_name = new std::string(object_id);
+	else
+	{
+		object_name = this->free_names_.back();
+		this->free_names_.pop_back();
+		*object_name = object_id;
+	}
+	body->setUserPointer(object_name);
+	return body;
+}
+
+void RigidBodyPool::release(btRigidBody* body)
+{
+	if (body == NULL) return;
+	std::string* object_name = (std::string*) body->getUserPointer();
+	if (object_name != NULL) this->free_names_.push_back(object_name);
+
+	btMotionState* motion_state = body->getMotionState();
+	if (motion_state != NULL)
+	{
+		motion_state->~btMotionState();
+		this->free_motion_states_.push_back(motion_state);
+	}
+
+	body->~btRigidBody();
+	this->free_bodies_.push_back(body);
+}
+
+std::size_t RigidBodyPool::getNumberOfFreeBodies() const
+{
+	return this->free_bodies_.size();
+}
+
+void RigidBodyPool::clear()
+{
+	for (std::vector<void*>::iterator it = this->free_bodies_.begin(); it != this->free_bodies_.end(); ++it)
+		btAlignedFree(*it);
+	for (std::vector<void*>::iterator it = this->free_motion_states_.begin(); it != this->free_motion_states_.end(); ++it)
+		btAlignedFree(*it);
+	for (std::vector<std::string*>::iterator it = this->free_names_.begin(); it != this->free_names_.end(); ++it)
+		delete *it;
+	this->free_bodies_.clear();
+	this->free_motion_states_.clear();
+	this->free_names_.clear();
+}
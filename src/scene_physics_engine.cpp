@@ -1,15 +1,91 @@
 #include "scene_physics_engine.h"
 
+static WorldCheckpoint::ContactManifoldKey getContactManifoldKey(const btPersistentManifold &manifold)
+{
+	// compound shapes have one manifold per child shape pair, which is stored in the contact point index
+	const btManifoldPoint &contact_point = manifold.getContactPoint(0);
+	return std::make_pair(
+		std::make_pair(getObjectIDFromCollisionObject(manifold.getBody0()), getObjectIDFromCollisionObject(manifold.getBody1())),
+		std::make_pair(contact_point.m_index0, contact_point.m_index1));
+}
+
+// pose of the object in the checkpoint. The background is not in the checkpoint, it does not move.
+static btTransform getCheckpointTransform(const WorldCheckpoint &checkpoint, const btCollisionObject* object)
+{
+	std::map<std::string, WorldCheckpoint::BodyState>::const_iterator it = 
+		checkpoint.body_state_.find(getObjectIDFromCollisionObject(object));
+	return it != checkpoint.body_state_.end() ? it->second.transform_ : object->getWorldTransform();
+}
+
+#ifdef BT_THREADSAFE
+// The Bullet task scheduler is global, so every multithreaded engine shares the same threads
+static bool setBulletTaskSchedulerThreadCount(const unsigned int &number_of_threads)
+{
+	static boost::mutex scheduler_mtx;
+	boost::mutex::scoped_lock lock(scheduler_mtx);
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (!scheduler || scheduler == btGetSequentialTaskScheduler())
+	{
+		scheduler = btCreateDefaultTaskScheduler();
+		if (!scheduler)
+		{
+			std::cerr << "Failed to create the Bullet task scheduler.\n";
+			return false;
+		}
+		btSetTaskScheduler(scheduler);
+	}
+	scheduler->setNumThreads(std::min(int(number_of_threads), scheduler->getMaxNumThreads()));
+	return true;
+}
+#endif
+
 static void _worldTickCallback(btDynamicsWorld *world, btScalar timeStep)
 { 
 	PhysicsEngine *physics_engine_world = static_cast<PhysicsEngine *>(world->getWorldUserInfo());
 	physics_engine_world->worldTickCallback(timeStep); 
 }
 
+// Skips the narrowphase of the objects whose oriented bounding boxes are further apart than the contact
+// breaking threshold. Their manifolds are emptied, like the narrowphase would do for separated objects.
+static void _obbCullingNearCallback(btBroadphasePair &collision_pair, btCollisionDispatcher &dispatcher, 
+	const btDispatcherInfo &dispatch_info)
+{
+	const btCollisionObject* object_0 = static_cast<btCollisionObject*>(collision_pair.m_pProxy0->m_clientObject);
+	const btCollisionObject* object_1 = static_cast<btCollisionObject*>(collision_pair.m_pProxy1->m_clientObject);
+	const CollisionDetailShapes* shapes_0 = getCollisionDetailShapes(object_0);
+	const CollisionDetailShapes* shapes_1 = getCollisionDetailShapes(object_1);
+	if (shapes_0 && shapes_1)
+	{
+		btScalar margin = std::max(object_0->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold),
+			object_1->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold));
+		if (!checkObbOverlap(object_0->getWorldTransform() * shapes_0->obb_pose_, shapes_0->obb_half_extents_,
+			object_1->getWorldTransform() * shapes_1->obb_pose_, shapes_1->obb_half_extents_, margin))
+		{
+			if (collision_pair.m_algorithm)
+			{
+				btManifoldArray manifolds;
+				collision_pair.m_algorithm->getAllContactManifolds(manifolds);
+				for (int i = 0; i < manifolds.size(); ++i) manifolds[i]->clearManifold();
+			}
+			return;
+		}
+	}
+	btCollisionDispatcher::defaultNearCallback(collision_pair, dispatcher, dispatch_info);
+}
+
 PhysicsEngine::PhysicsEngine() : have_background_(false), debug_messages_(false), 
 	rendering_launched_(false), in_simulation_(false),
-	use_background_normal_as_gravity_(false), simulation_step_(1./200.), 
-	skip_scene_evaluation_(false)
+	use_background_normal_as_gravity_(false), camera_coordinate_(0,0,0), target_coordinate_(0,0,0),
+	simulation_step_(1./200.), 
+	skip_scene_evaluation_(false), check_convergence_(false), simulation_converged_(false),
+	commands_pending_(false), world_stepped_(false), m_solver_mt_(0), world_thread_count_(1),
+	render_front_(0), render_version_(0), quasi_static_settling_(false), quasi_static_active_(false),
+	contact_only_scene_graph_(false), adaptive_timestep_(false), adaptive_timestep_active_(false),
+	background_(NULL), object_eviction_frames_(0), resident_bodies_(false),
+	broadphase_type_(DBVT_BROADPHASE), broadphase_workspace_margin_(0.5 * SCALING),
+	broadphase_aabb_min_(btVector3(-2,-2,-2) * SCALING), broadphase_aabb_max_(btVector3(2,2,2) * SCALING),
+	collision_detail_level_(COLLISION_DETAIL_FULL), obb_pair_culling_(false),
+	depenetration_prepass_(false), depenetration_pending_(false)
 {
 	if (this->debug_messages_) std::cerr << "Setting up physics engine.\n";
 	this->initPhysics();
@@ -20,15 +96,17 @@ void PhysicsEngine::addBackgroundPlane(btVector3 plane_normal, btScalar plane_co
 {
 	mtx_.lock();
 	if (this->debug_messages_) std::cerr << "Adding background(plane) to the physics engine's world.\n";
+	this->removeBackground();
+	// the plane has no bounds, the workspace is around its center
+	this->fitBroadphaseToBackground(plane_center, plane_center);
 	btCollisionShape*  background = new btStaticPlaneShape(plane_normal, plane_constant);
-	btDefaultMotionState* background_motion_state = new btDefaultMotionState(
-		btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0)));
 	
 	// unmovable ground object
 	btRigidBody::btRigidBodyConstructionInfo
-			background_RigidBodyCI(0, background_motion_state, background, btVector3(0, 0, 0));
+			background_RigidBodyCI(0, NULL, background, btVector3(0, 0, 0));
 	
-	this->background_ = new btRigidBody(background_RigidBodyCI);
+	this->background_ = this->body_pool_.acquire("background", background_RigidBodyCI, 
+		btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0)));
 	m_dynamicsWorld->addRigidBody(this->background_);
 	this->background_->setFriction(1.f);
 	this->background_->setRollingFriction(1.f);
@@ -36,17 +114,11 @@ void PhysicsEngine::addBackgroundPlane(btVector3 plane_normal, btScalar plane_co
 
 	this->camera_coordinate_ = btVector3(0,0,0);
 	this->target_coordinate_ = plane_center;
-	this->setCameraPositionAndTarget(camera_coordinate_,target_coordinate_);
-	this->setCameraClippingPlaneNearFar(0.005f);
 	this->background_surface_normal_ = plane_normal;
 	if (this->use_background_normal_as_gravity_)
 		this->setGravityVectorDirection(-background_surface_normal_);
 	m_collisionShapes.push_back(background);
-
-	// set the background name
-	std::string * background_name = new std::string("background");
-	this->background_->setUserPointer(background_name);
-	mtx_.unlock();
+	this->releaseWorld();
 }
 
 void PhysicsEngine::addBackgroundConvexHull(const std::vector<btVector3> &plane_points, btVector3 plane_normal)
@@ -54,8 +126,10 @@ void PhysicsEngine::addBackgroundConvexHull(const std::vector<btVector3> &plane_
 	mtx_.lock();
 
 	if (this->debug_messages_) std::cerr << "Adding background(convex hull) to the physics engine's world.\n";
+	this->removeBackground();
 	
 	btVector3 plane_center(0,0,0);
+	btVector3 points_min(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT), points_max = -points_min;
 
 	btConvexHullShape background_convex;
 	btScalar hull_margin = 0.02 * SCALING;
@@ -67,7 +141,10 @@ void PhysicsEngine::addBackgroundConvexHull(const std::vector<btVector3> &plane_
 		btVector3 tmp = *it - plane_normal_direction * hull_margin; // 5 cm 
 		background_convex.addPoint(tmp, true);
 		plane_center+= *it;
+		points_min.setMin(*it);
+		points_max.setMax(*it);
 	}
+	this->fitBroadphaseToBackground(points_min, points_max);
 
 #if 0
 	// add extra points with extruded position to thicken the table convex hull
@@ -84,18 +161,15 @@ void PhysicsEngine::addBackgroundConvexHull(const std::vector<btVector3> &plane_
 	// since everything is in reference to camera coordinate, camera coordinate is 0,0,0
 	this->camera_coordinate_ = btVector3(0,0,0);
 	this->target_coordinate_ = plane_center;
-	this->setCameraPositionAndTarget(camera_coordinate_,target_coordinate_);
-	this->setCameraClippingPlaneNearFar(0.005f);
 
 	btCollisionShape*  background = new btConvexHullShape(background_convex);
-	btDefaultMotionState* background_motion_state = new btDefaultMotionState(
-		btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0)));
 	
 	// unmovable ground object
 	btRigidBody::btRigidBodyConstructionInfo
-			background_RigidBodyCI(0, background_motion_state, background, btVector3(0, 0, 0));
+			background_RigidBodyCI(0, NULL, background, btVector3(0, 0, 0));
 	
-	this->background_ = new btRigidBody(background_RigidBodyCI);
+	this->background_ = this->body_pool_.acquire("background", background_RigidBodyCI, 
+		btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0)));
 	this->background_->setFriction(1.f);
 	this->background_->setRollingFriction(1.f);
 	
@@ -117,13 +191,9 @@ void PhysicsEngine::addBackgroundConvexHull(const std::vector<btVector3> &plane_
 		this->setGravityVectorDirection(-background_surface_normal_);
 
 
-	// set the background name
-	std::string * background_name = new std::string("background");
-	this->background_->setUserPointer(background_name);
-
 	m_collisionShapes.push_back(background);
 
-	mtx_.unlock();
+	this->releaseWorld();
 
 }
 
@@ -131,10 +201,9 @@ void PhysicsEngine::addBackgroundMesh(btTriangleMesh* trimesh, btVector3 plane_n
 {
 	mtx_.lock();
 	if (this->debug_messages_) std::cerr << "Adding background(mesh).\n";
+	this->removeBackground();
 	this->camera_coordinate_ = btVector3(0,0,0);
 	this->target_coordinate_ = plane_center;
-	this->setCameraPositionAndTarget(camera_coordinate_,target_coordinate_);
-	this->setCameraClippingPlaneNearFar(0.005f);
 	this->background_surface_normal_ = plane_normal;
 	if (this->use_background_normal_as_gravity_)
 		this->setGravityVectorDirection(-background_surface_normal_);
@@ -142,24 +211,23 @@ void PhysicsEngine::addBackgroundMesh(btTriangleMesh* trimesh, btVector3 plane_n
 	bool useQuantizedBvhTree = true;
 
 	btCollisionShape* background  = new btBvhTriangleMeshShape(trimesh,useQuantizedBvhTree);
-	btDefaultMotionState* background_motion_state = new btDefaultMotionState(
-		btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0)));
+	btVector3 mesh_min, mesh_max;
+	background->getAabb(btTransform::getIdentity(), mesh_min, mesh_max);
+	this->fitBroadphaseToBackground(mesh_min, mesh_max);
 	
 	// unmovable ground object
 	btRigidBody::btRigidBodyConstructionInfo
-			background_RigidBodyCI(0, background_motion_state, background, btVector3(0, 0, 0));
+			background_RigidBodyCI(0, NULL, background, btVector3(0, 0, 0));
 	
-	this->background_ = new btRigidBody(background_RigidBodyCI);
+	this->background_ = this->body_pool_.acquire("background", background_RigidBodyCI, 
+		btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0)));
 	this->background_->setFriction(1.f);
 	this->background_->setRollingFriction(1.f);
 	
 	m_dynamicsWorld->addRigidBody(this->background_);
 	this->have_background_ = true;
-
-	// set the background name
-	std::string * background_name = new std::string("background");
-	this->background_->setUserPointer(background_name);
-	mtx_.unlock();
+	m_collisionShapes.push_back(background);
+	this->releaseWorld();
 }
 
 void PhysicsEngine::setGravityVectorDirectionFromTfYUp(const btTransform &transform_y_is_inverse_gravity_direction)
@@ -211,12 +279,14 @@ btVector3 PhysicsEngine::getGravityDirection() const
 	return this->gravity_unit_vector_;
 }
 
-void PhysicsEngine::addObjects(const std::vector<ObjectWithID> &objects)
+void PhysicsEngine::addObjects(const std::vector<ObjectWithID> &objects, 
+	const std::set<std::string> &referenced_objects)
 {
 	mtx_.lock();
 
 	// Add new objects
 	if (this->debug_messages_) std::cerr << "Adding scene objects to the physics engine.\n";
+	std::set<std::string> detected_objects;
 	
 	for (std::vector<ObjectWithID>::const_iterator it = objects.begin(); 
 		it != objects.end(); ++it)
@@ -227,52 +297,47 @@ void PhysicsEngine::addObjects(const std::vector<ObjectWithID> &objects)
 		this->object_best_pose_from_data_[it->getID()] = it->getTransform();
 
 		// Only generates new rigid body if it does not exist. Otherwise, update existing rigid body.
-		if (!keyExistInConstantMap(it->getID(),this->rigid_body_))
+		btRigidBody* object = this->getRigidBody(it->getID());
+		detected_objects.insert(it->getID());
+		if (!object)
 		{
-			this->rigid_body_[it->getID()] = it->generateRigidBodyForWorld();
+			object = this->body_pool_.acquire(it->getID(), it->getRigidBodyConstructionInfo(NULL), it->getTransform());
 			if (this->debug_messages_) std::cerr << "Adding rigid body " 
 				<< it->getID() << " to the physics engine's world.\n";
 
-			// set the name of the object in the collision object
-			std::string * object_name = new std::string(it->getID());
-			this->rigid_body_[it->getID()]->setUserPointer(object_name);
-
-			object_penalty_parameter_database_by_id_[it->getID()] = 
-				(*object_penalty_parameter_database_)[it->getObjectClass()];
-			object_label_class_map_[it->getID()] = it->getObjectClass();
+			this->object_table_.addObject(it->getID(), it->getObjectClass(), object,
+				(*object_penalty_parameter_database_)[it->getObjectClass()]);
 
 			// add the best pose from hypothesis to cached icp result for new objects. Otherwise, use the previous best pose for cached icp result
-			data_forces_generator_->manualSetCachedIcpResultMapFromPose(
-				*(this->rigid_body_[it->getID()]), it->getObjectClass());
+			data_forces_generator_->manualSetCachedIcpResultMapFromPose(*object, it->getObjectClass());
 		}
 		else
 		{
 			if (this->debug_messages_) std::cerr << "Updated existing rigid body " 
 				<< it->getID() << " in the physics engine's world.\n";
-			this->rigid_body_[it->getID()]->setWorldTransform(it->getTransform());
+			object->setWorldTransform(it->getTransform());
 		}
 		
-		// skips object that are not in the world
-		if (!this->rigid_body_[it->getID()]->isInWorld())
-		{
-			m_dynamicsWorld->addRigidBody(this->rigid_body_[it->getID()]);
-		}
+		this->setBodyCollisionDetail(object);
+		this->enableRigidBody(object);
 
 		if (this->debug_messages_)
 		{
-			std::cerr << "Object " << it->getID() <<", address: " << this->rigid_body_[it->getID()]  <<": \n";
+			std::cerr << "Object " << it->getID() <<", address: " << object  <<": \n";
 			btTransform object_tf;
-			this->rigid_body_[it->getID()]->getMotionState()->getWorldTransform(object_tf);
+			object->getMotionState()->getWorldTransform(object_tf);
 			btQuaternion q = object_tf.getRotation();
 			btVector3 t = object_tf.getOrigin();
 			std::cerr << "Quaterion: " << q[0] << ", " << q[1] << ", "  << q[2] << ", "  << q[3] << std::endl;
 			std::cerr << "Translation: " << t[0]  << ", " << t[1]  << ", " << t[2] << std::endl;
 		}
 	}
+	this->evictMissingObjects(detected_objects, referenced_objects);
 	this->object_best_test_pose_map_ = this->object_best_pose_from_data_;
+	this->resetInitialPenetration();
 	if (this->debug_messages_) std::cerr << "Scene objects added to the physics engine.\n";
 
-	mtx_.unlock();
+	this->releaseWorld();
 }
 
 void PhysicsEngine::simulate()
@@ -290,33 +355,52 @@ void PhysicsEngine::simulate()
 	mtx_.lock();
 	this->in_simulation_ = false;
 	this->world_tick_counter_ = 0;
-	this->object_velocity_.clear();
-	this->object_acceleration_.clear();
+	this->object_table_.resetMotionHistory();
 
 	this->in_simulation_ = true;
-	mtx_.unlock();
-
-	if (this->rendering_launched_)
+	// the objects are moved before the warm start, which checks how far they moved
+	if (this->depenetration_pending_) this->depenetrateObjects();
+	this->applyWarmStartContacts();
+	this->timestep_statistics_ = TimestepStatistics();
+	this->quasi_static_active_ = this->quasi_static_settling_ && this->skip_scene_evaluation_;
+	if (this->quasi_static_active_) this->startQuasiStaticSettling();
+	this->adaptive_timestep_active_ = this->adaptive_timestep_ && this->skip_scene_evaluation_ && 
+		!this->quasi_static_active_;
+	if (this->adaptive_timestep_active_) this->startAdaptiveTimestep();
+	// the adaptive step covers the same simulated time as the fixed steps, in a varying number of ticks
+	btScalar simulation_time = this->number_of_world_tick_ * this->simulation_step_;
+
+	// this thread keeps the world until the simulation ends, the renderer only reads the published poses
+	// TODO: Find out why the simulation step not syncing with the internal step callback.
+	for (int i = 0; i < this->number_of_world_tick_ || this->adaptive_timestep_active_; i++)
 	{
-		while (this->in_simulation_ && this->world_tick_counter_ < this->number_of_world_tick_ )
+		if (this->quasi_static_active_ || this->adaptive_timestep_active_)
 		{
-			// Do nothing;
-			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+			if (this->adaptive_timestep_active_ && this->timestep_statistics_.simulated_time_ >= simulation_time) break;
+			// one internal step with the time step chosen by the previous tick
+			btScalar step = this->quasi_static_active_ ? this->quasi_static_step_ : this->adaptive_step_;
+			m_dynamicsWorld->stepSimulation(step, 0);
+			this->previous_tick_step_ = step;
 		}
+		else
+			m_dynamicsWorld->stepSimulation(simulation_step_, 2, fixed_step_);
+		if (this->commands_pending_.load(boost::memory_order_acquire)) this->applyPendingCommands();
+		// if (this->checkSteadyState()) break;
+		if (this->simulation_converged_) break;
 	}
-	else if (this->in_simulation_ && !this->rendering_launched_)
+	this->world_stepped_ = true;
+
+	if (this->quasi_static_active_)
 	{
-		// TODO: Find out why the simulation step not syncing with the internal step callback.
-		for (int i = 0; i < this->number_of_world_tick_; i++)
-		{
-			m_dynamicsWorld->stepSimulation(simulation_step_, 2, fixed_step_);
-			// if (this->checkSteadyState()) break;
-		}
+		// leave the objects at rest, like the velocity reset dynamics
+		this->stopAllObjectMotion();
+		this->quasi_static_active_ = false;
+		if (!this->check_convergence_) this->simulation_converged_ = false;
 	}
+	this->adaptive_timestep_active_ = false;
 
-	mtx_.lock();
 	this->in_simulation_ = false;
-	mtx_.unlock();
+	this->releaseWorld();
 }
 
 void PhysicsEngine::stepSimulationWithoutEvaluation(const double & delta_time, const double &simulation_step, const bool &data_forces_enabled)
@@ -332,33 +416,363 @@ void PhysicsEngine::stepSimulationWithoutEvaluation(const double & delta_time, c
 	this->in_simulation_ = true;
 	btScalar fixed_step = simulation_step_ / 1 * 1.05;
 	this->number_of_world_tick_ = number_of_world_tick_to_step;
-	mtx_.unlock();
+	this->releaseWorld();
 
 	this->simulate();
 	
 	mtx_.lock();
 	this->skip_scene_evaluation_ = false;
 	this->number_of_world_tick_ = tmp;
-	mtx_.unlock();
+	this->releaseWorld();
+}
+
+unsigned int PhysicsEngine::stepSimulationUntilConvergence(const double &max_delta_time, const double &simulation_step, 
+	const bool &data_forces_enabled)
+{
+	mtx_.lock();
+	this->check_convergence_ = true;
+	this->simulation_converged_ = false;
+	this->settled_tick_counter_ = 0;
+	this->data_forces_magnitude_ = 0;
+	this->previous_data_forces_magnitude_ = -1;
+	this->releaseWorld();
+
+	this->stepSimulationWithoutEvaluation(max_delta_time, simulation_step, data_forces_enabled);
+
+	mtx_.lock();
+	unsigned int number_of_ticks = this->world_tick_counter_;
+	if (this->debug_messages_)
+	{
+		std::cerr << "Simulation " << (this->simulation_converged_ ? "converged" : "did not converge") 
+			<< " after " << number_of_ticks << " ticks.\n";
+		if (this->adaptive_timestep_)
+		{
+			const TimestepStatistics &statistics = this->timestep_statistics_;
+			std::cerr << "Time step min/avg/max: " << statistics.min_step_ << "/" << statistics.getAverageStep() 
+				<< "/" << statistics.max_step_ << ", " << statistics.number_of_step_decreases_ << " decreases, "
+				<< statistics.number_of_step_increases_ << " increases, max penetration " 
+				<< statistics.max_penetration_depth_ << ".\n";
+		}
+	}
+	this->check_convergence_ = false;
+	this->simulation_converged_ = false;
+	this->releaseWorld();
+	return number_of_ticks;
+}
+
+void PhysicsEngine::setConvergenceCriteria(const ConvergenceCriteria &criteria)
+{
+	this->convergence_criteria_ = criteria;
+}
+
+void PhysicsEngine::setQuasiStaticSettling(const bool &flag)
+{
+	this->quasi_static_settling_ = flag;
+}
+
+void PhysicsEngine::setQuasiStaticParameters(const QuasiStaticParameters &parameters)
+{
+	this->quasi_static_parameters_ = parameters;
+}
+
+void PhysicsEngine::startQuasiStaticSettling()
+{
+	this->quasi_static_step_ = this->simulation_step_;
+	this->previous_tick_step_ = this->simulation_step_;
+	this->quasi_static_mixing_ = this->quasi_static_parameters_.mixing_start_;
+	this->quasi_static_positive_ticks_ = 0;
+
+	// the settling always stops when the objects are at rest
+	this->simulation_converged_ = false;
+	this->settled_tick_counter_ = 0;
+	this->data_forces_magnitude_ = 0;
+	this->previous_data_forces_magnitude_ = -1;
+}
+
+void PhysicsEngine::relaxQuasiStaticVelocities(const btScalar &timeStep)
+{
+	const QuasiStaticParameters &parameters = this->quasi_static_parameters_;
+	ObjectBodyTable &table = this->object_table_;
+	btVector3 zero_vector(0,0,0);
+	btScalar total_power = 0;
+	for (std::size_t handle = 0; handle < table.size(); ++handle)
+	{
+		btRigidBody* object = table.rigid_body_[handle];
+		// skips object that are not in the world
+		if (!isCollisionObjectEnabled(object) || object->isStaticObject())
+		{
+			continue;
+		}
+
+		btVector3 linear_velocity = object->getLinearVelocity(),
+			angular_velocity = object->getAngularVelocity();
+		// the net force is only known from the second tick, start from rest
+		btScalar power = -1;
+		if (table.acceleration_cached_[handle])
+		{
+			// power of the net force and torque on the current motion, the torque is taken in the object frame
+			const MovementComponent &acceleration = table.acceleration_[handle];
+			btMatrix3x3 world_to_local = object->getWorldTransform().getBasis().transpose();
+			btVector3 inverse_inertia = object->getInvInertiaDiagLocal();
+			btVector3 inertia(inverse_inertia[0] > 0 ? 1 / inverse_inertia[0] : 0, 
+				inverse_inertia[1] > 0 ? 1 / inverse_inertia[1] : 0, inverse_inertia[2] > 0 ? 1 / inverse_inertia[2] : 0);
+			power = acceleration.linear_.dot(linear_velocity) / object->getInvMass() + 
+				(inertia * (world_to_local * acceleration.angular_)).dot(world_to_local * angular_velocity);
+			total_power += power;
+
+			// turn the motion toward the net force
+			if (linear_velocity.length() > SIMD_EPSILON && acceleration.linear_.length() > SIMD_EPSILON)
+			{
+				linear_velocity = (1 - quasi_static_mixing_) * linear_velocity + 
+					quasi_static_mixing_ * linear_velocity.length() * acceleration.linear_.normalized();
+			}
+			if (angular_velocity.length() > SIMD_EPSILON && acceleration.angular_.length() > SIMD_EPSILON)
+			{
+				angular_velocity = (1 - quasi_static_mixing_) * angular_velocity + 
+					quasi_static_mixing_ * angular_velocity.length() * acceleration.angular_.normalized();
+			}
+		}
+
+		// the object passed its equilibrium or hit another object
+		if (power <= 0)
+		{
+			linear_velocity = zero_vector;
+			angular_velocity = zero_vector;
+		}
+
+		btScalar displacement = linear_velocity.length() * timeStep;
+		if (displacement > parameters.max_displacement_per_tick_)
+			linear_velocity *= parameters.max_displacement_per_tick_ / displacement;
+		btScalar rotation = angular_velocity.length() * timeStep;
+		if (rotation > parameters.max_rotation_per_tick_)
+			angular_velocity *= parameters.max_rotation_per_tick_ / rotation;
+
+		object->setLinearVelocity(linear_velocity);
+		object->setAngularVelocity(angular_velocity);
+		table.velocity_[handle].setValue(linear_velocity, angular_velocity);
+	}
+
+	// grow the pseudo time step while the whole scene moves downhill, and fall back when it overshoots
+	if (total_power > 0)
+	{
+		if (++this->quasi_static_positive_ticks_ > parameters.minimum_positive_ticks_)
+		{
+			this->quasi_static_step_ = std::min(btScalar(this->quasi_static_step_ * parameters.step_increase_), 
+				btScalar(this->simulation_step_ * parameters.max_step_multiplier_));
+			this->quasi_static_mixing_ *= parameters.mixing_decrease_;
+		}
+	}
+	else
+	{
+		this->quasi_static_step_ = std::max(btScalar(this->quasi_static_step_ * parameters.step_decrease_), 
+			btScalar(this->simulation_step_));
+		this->quasi_static_mixing_ = parameters.mixing_start_;
+		this->quasi_static_positive_ticks_ = 0;
+	}
+}
+
+void PhysicsEngine::setAdaptiveTimestep(const bool &flag)
+{
+	this->adaptive_timestep_ = flag;
+}
+
+void PhysicsEngine::setAdaptiveTimestepParameters(const AdaptiveTimestepParameters &parameters)
+{
+	this->adaptive_timestep_parameters_ = parameters;
+}
+
+TimestepStatistics PhysicsEngine::getTimestepStatistics() const
+{
+	return this->timestep_statistics_;
+}
+
+void PhysicsEngine::setDepenetrationPrepass(const bool &flag)
+{
+	this->depenetration_prepass_ = flag;
+}
+
+void PhysicsEngine::setDepenetrationParameters(const DepenetrationParameters &parameters)
+{
+	this->depenetration_parameters_ = parameters;
+}
+
+// Deepest overlap of an object with each other object, and the total penetration of the object
+struct DepenetrationContactCallback : public btCollisionWorld::ContactResultCallback
+{
+	DepenetrationContactCallback(const btCollisionObject* object) : object_(object), total_penetration_(0) {}
+
+	virtual btScalar addSingleResult(btManifoldPoint& cp,
+		const btCollisionObjectWrapper* colObj0,int partId0,int index0,
+		const btCollisionObjectWrapper* colObj1,int partId1,int index1)
+	{
+		btScalar depth = -cp.getDistance();
+		if (depth <= 0) return 0;
+		total_penetration_ += depth;
+
+		// the normal points from object 1 to object 0
+		bool object_is_0 = colObj0->getCollisionObject() == object_;
+		const btCollisionObject* other = object_is_0 ? colObj1->getCollisionObject() : colObj0->getCollisionObject();
+		std::pair<btScalar, btVector3> &deepest_overlap = deepest_overlap_[other];
+		if (depth > deepest_overlap.first)
+		{
+			deepest_overlap = std::make_pair(depth, object_is_0 ? cp.m_normalWorldOnB : -cp.m_normalWorldOnB);
+		}
+		return 0;
+	}
+
+	const btCollisionObject* object_;
+	btScalar total_penetration_;
+	// depth and the direction that moves the object out of the other object
+	std::map<const btCollisionObject*, std::pair<btScalar, btVector3> > deepest_overlap_;
+};
+
+void PhysicsEngine::resetInitialPenetration()
+{
+	std::fill(this->object_table_.initial_penetration_.begin(), this->object_table_.initial_penetration_.end(), 0);
+	this->depenetration_pending_ = true;
+}
+
+void PhysicsEngine::depenetrateObjects()
+{
+	this->depenetration_pending_ = false;
+	if (!this->depenetration_prepass_) return;
+
+	const DepenetrationParameters &parameters = this->depenetration_parameters_;
+	ObjectBodyTable &table = this->object_table_;
+	std::vector<btVector3> total_translation(table.size(), btVector3(0,0,0));
+	std::vector<btVector3> translation(table.size());
+	unsigned int number_of_iterations = 0;
+	for (; number_of_iterations < parameters.max_iterations_; ++number_of_iterations)
+	{
+		// the translations of an iteration are all computed from the poses of the previous iteration
+		for (std::size_t handle = 0; handle < table.size(); ++handle)
+		{
+			translation[handle].setZero();
+			btRigidBody* object = table.rigid_body_[handle];
+			if (!isCollisionObjectEnabled(object) || object->isStaticOrKinematicObject()) continue;
+
+			DepenetrationContactCallback callback(object);
+			m_dynamicsWorld->contactTest(object, callback);
+			if (number_of_iterations == 0) table.initial_penetration_[handle] = callback.total_penetration_;
+			for (std::map<const btCollisionObject*, std::pair<btScalar, btVector3> >::const_iterator it = 
+				callback.deepest_overlap_.begin(); it != callback.deepest_overlap_.end(); ++it)
+			{
+				btScalar depth = it->second.first - parameters.penetration_slop_;
+				if (depth <= 0) continue;
+				// a dynamic neighbor moves the other half
+				if (!it->first->isStaticOrKinematicObject()) depth *= 0.5;
+				translation[handle] += it->second.second * depth;
+			}
+		}
+
+		bool objects_moved = false;
+		for (std::size_t handle = 0; handle < table.size(); ++handle)
+		{
+			if (translation[handle].fuzzyZero()) continue;
+			btVector3 new_total_translation = total_translation[handle] + translation[handle];
+			if (new_total_translation.length() > parameters.max_translation_)
+			{
+				new_total_translation *= parameters.max_translation_ / new_total_translation.length();
+			}
+			btVector3 step = new_total_translation - total_translation[handle];
+			if (step.fuzzyZero()) continue;
+			total_translation[handle] = new_total_translation;
+
+			btRigidBody* object = table.rigid_body_[handle];
+			btTransform transform = object->getCenterOfMassTransform();
+			transform.getOrigin() += step;
+			object->setCenterOfMassTransform(transform);
+			object->getMotionState()->setWorldTransform(transform);
+			m_dynamicsWorld->updateSingleAabb(object);
+			objects_moved = true;
+		}
+		if (!objects_moved) break;
+	}
+
+	if (this->debug_messages_)
+	{
+		btScalar max_translation = 0;
+		for (std::size_t handle = 0; handle < table.size(); ++handle)
+		{
+			max_translation = std::max(max_translation, total_translation[handle].length());
+		}
+		std::cerr << "Depenetration pre-pass: " << number_of_iterations << " iterations, max translation " 
+			<< max_translation << ".\n";
+	}
+}
+
+void PhysicsEngine::startAdaptiveTimestep()
+{
+	this->adaptive_step_ = this->fixed_step_ * this->adaptive_timestep_parameters_.max_step_multiplier_;
+	this->previous_tick_step_ = this->adaptive_step_;
+	this->adaptive_previous_data_forces_magnitude_ = -1;
+	this->adaptive_calm_ticks_ = 0;
+}
+
+void PhysicsEngine::updateAdaptiveTimestep()
+{
+	const AdaptiveTimestepParameters &parameters = this->adaptive_timestep_parameters_;
+	TimestepStatistics &statistics = this->timestep_statistics_;
+
+	// the error is the largest ratio of a residual to its tolerance
+	btScalar penetration_depth = this->getMaxPenetrationDepth();
+	statistics.max_penetration_depth_ = std::max(statistics.max_penetration_depth_, penetration_depth);
+	btScalar error = penetration_depth / parameters.penetration_tolerance_;
+	if (this->enable_data_forces_)
+	{
+		if (this->adaptive_previous_data_forces_magnitude_ >= 0)
+		{
+			btScalar data_forces_change = std::fabs(this->data_forces_magnitude_ - this->adaptive_previous_data_forces_magnitude_) /
+				std::max(this->data_forces_magnitude_, btScalar(1e-6));
+			error = std::max(error, data_forces_change / parameters.data_forces_change_tolerance_);
+		}
+		this->adaptive_previous_data_forces_magnitude_ = this->data_forces_magnitude_;
+	}
+
+	btScalar min_step = this->fixed_step_ * parameters.min_step_multiplier_,
+		max_step = this->fixed_step_ * parameters.max_step_multiplier_;
+	if (error > 1)
+	{
+		// shrink in proportion to the error, with a safety factor
+		btScalar step = std::max(btScalar(this->adaptive_step_ * std::max(parameters.step_decrease_, btScalar(0.9 / error))), 
+			min_step);
+		if (step < this->adaptive_step_) ++statistics.number_of_step_decreases_;
+		this->adaptive_step_ = step;
+		this->adaptive_calm_ticks_ = 0;
+	}
+	else if (error < 0.5)
+	{
+		if (++this->adaptive_calm_ticks_ >= parameters.minimum_calm_ticks_ && this->adaptive_step_ < max_step)
+		{
+			this->adaptive_step_ = std::min(btScalar(this->adaptive_step_ * parameters.step_increase_), max_step);
+			++statistics.number_of_step_increases_;
+		}
+	}
+	else this->adaptive_calm_ticks_ = 0;
+}
+
+unsigned int PhysicsEngine::getNumberOfSimulatedTicks() const
+{
+	return this->world_tick_counter_;
 }
 
 void PhysicsEngine::removeAllRigidBodyFromWorld()
 {
 	mtx_.lock();
-	for (std::map<std::string, btRigidBody*>::iterator it = this->rigid_body_.begin(); 
-		it != this->rigid_body_.end(); ++it)
+	for (std::size_t handle = 0; handle < this->object_table_.size(); ++handle)
 	{
-		m_dynamicsWorld->removeRigidBody(it->second);
-		if (this->debug_messages_) std::cerr << "Removed object "<<  it->first <<" from world.\n";
+		this->disableRigidBody(this->object_table_.rigid_body_[handle]);
+		if (this->debug_messages_) std::cerr << "Removed object "<<  this->object_table_.object_id_[handle] <<" from world.\n";
 	}
 	this->object_best_test_pose_map_.clear();
-	mtx_.unlock();
+	this->releaseWorld();
 }
 
 void PhysicsEngine::addExistingRigidBodyBackFromMap(const std::string &object_id, const btTransform &object_pose)
 {
 	mtx_.lock();
-	if (!keyExistInConstantMap(object_id, this->rigid_body_))
+	btRigidBody* object = this->getRigidBody(object_id);
+	if (!object)
 	{
 		// need to generate new rigid body
 		std::cerr << "ERROR: UNIMPLEMENTED AUTO ADD OBJECT BACK.\n";
@@ -370,12 +784,12 @@ void PhysicsEngine::addExistingRigidBodyBackFromMap(const std::string &object_id
 	else
 	{
 		if (this->debug_messages_) std::cerr << "Add object "<<  object_id <<" back to world.\n";
-		this->rigid_body_[object_id]->setWorldTransform(object_pose);
+		object->setWorldTransform(object_pose);
 		this->object_best_test_pose_map_[object_id] = object_pose;
-		if (!this->rigid_body_[object_id]->isInWorld()) m_dynamicsWorld->addRigidBody(this->rigid_body_[object_id]);
-		this->rigid_body_[object_id]->activate();
+		this->enableRigidBody(object);
+		object->activate();
 	}
-	mtx_.unlock();
+	this->releaseWorld();
 }
 
 void PhysicsEngine::addExistingRigidBodyBackFromMap(const std::map<std::string, btTransform> &rigid_bodies)
@@ -398,12 +812,12 @@ void PhysicsEngine::removeExistingRigidBodyWithMap(const std::map<std::string, b
 		if (it->first == "background") continue;
 		if (keyExistInConstantMap(it->first, this->object_best_test_pose_map_))
 		{
-			m_dynamicsWorld->removeRigidBody(this->rigid_body_[it->first]);
+			this->disableRigidBody(this->getRigidBody(it->first));
 			this->object_best_test_pose_map_.erase(it->first);
 			if (this->debug_messages_) std::cerr << "Removed object "<<  it->first <<" from world.\n";
 		}
 	}
-	mtx_.unlock();
+	this->releaseWorld();
 }
 
 std::map<std::string, btTransform> PhysicsEngine::getAssociatedBestPoseDataFromStringVector(
@@ -421,17 +835,17 @@ std::map<std::string, btTransform> PhysicsEngine::getAssociatedBestPoseDataFromS
 bool PhysicsEngine::checkSteadyState()
 {
 	bool steady_state = true;
-	for (std::map<std::string, btRigidBody*>::const_iterator it = this->rigid_body_.begin(); 
-		it != this->rigid_body_.end(); ++it)
+	for (std::vector<btRigidBody*>::const_iterator it = this->object_table_.rigid_body_.begin(); 
+		it != this->object_table_.rigid_body_.end(); ++it)
 	{
 		// skips object that are not in the world
-		if (!it->second->isInWorld())
+		if (!isCollisionObjectEnabled(*it))
 		{
 			continue;
 		}
 
 		// Check if any object is still moving
-		if (it->second->getActivationState() == 1)
+		if ((*it)->getActivationState() == 1)
 		{
 			steady_state = false;
 			break;
@@ -452,31 +866,48 @@ std::map<std::string, btTransform> PhysicsEngine::getUpdatedObjectPoses()
 std::map<std::string, btTransform> PhysicsEngine::getCurrentObjectPoses()
 {
 	if (this->debug_messages_) std::cerr << "Get current object poses.\n";
-	std::map<std::string, btTransform> result_pose;
-	mtx_.lock();
+	if (!this->in_simulation_)
+	{
+		// the world is only changed by a short command, wait for the current poses
+		mtx_.lock();
+	}
+	else if (!mtx_.try_lock())
+	{
+		// another thread is simulating, use the poses from its last simulation
+		boost::shared_ptr<const PhysicsEngineSnapshot> snapshot = boost::atomic_load(&this->snapshot_);
+		if (snapshot) return snapshot->object_poses_;
+		mtx_.lock();
+	}
+	std::map<std::string, btTransform> result_pose = this->collectObjectPoses();
+	this->releaseWorld();
+
+	return result_pose;
+}
 
-	for (std::map<std::string, btRigidBody*>::const_iterator it = this->rigid_body_.begin(); 
-		it != this->rigid_body_.end(); ++it)
+std::map<std::string, btTransform> PhysicsEngine::collectObjectPoses() const
+{
+	std::map<std::string, btTransform> result_pose;
+	for (std::size_t handle = 0; handle < this->object_table_.size(); ++handle)
 	{
+		const btRigidBody* object = this->object_table_.rigid_body_[handle];
 		// skips object that are not in the world
-		if (!it->second->isInWorld())
+		if (!isCollisionObjectEnabled(object))
 		{
 			continue;
 		}
 
-		it->second->getMotionState()->getWorldTransform(result_pose[it->first]);
+		const std::string &object_id = this->object_table_.object_id_[handle];
+		object->getMotionState()->getWorldTransform(result_pose[object_id]);
 
 		if (this->debug_messages_)
 		{
-			std::cerr << "Object " << it->first << std::endl;
-			btQuaternion q = result_pose[it->first].getRotation();
-			btVector3 t = result_pose[it->first].getOrigin();
+			std::cerr << "Object " << object_id << std::endl;
+			btQuaternion q = result_pose[object_id].getRotation();
+			btVector3 t = result_pose[object_id].getOrigin();
 			std::cerr << "Quaterion: " << q[0] << ", " << q[1] << ", "  << q[2] << ", "  << q[3] << std::endl;
 			std::cerr << "Translation: " << t[0]  << ", " << t[1]  << ", " << t[2] << std::endl;
 		}
 	}
-	mtx_.unlock();
-
 	return result_pose;
 }
 
@@ -485,61 +916,71 @@ void PhysicsEngine::resetObjects(const bool &permanent_removal)
 	mtx_.lock();
 	if (this->debug_messages_) std::cerr << "Removing all scene objects.\n";
 	// Removes all objects from the physics world then delete its' content
-	for (std::map<std::string, btRigidBody*>::iterator it = this->rigid_body_.begin(); 
-		it != this->rigid_body_.end(); ++it)
+	for (std::size_t handle = 0; handle < this->object_table_.size(); ++handle)
 	{
-		m_dynamicsWorld->removeRigidBody(it->second);
-		if (permanent_removal)
+		btRigidBody* object = this->object_table_.rigid_body_[handle];
+		if (!permanent_removal) this->disableRigidBody(object);
+		else
 		{
-			delete (std::string*) it->second->getUserPointer();
-			delete it->second->getMotionState();
-			delete it->second;
+			if (object->isInWorld()) m_dynamicsWorld->removeRigidBody(object);
+			this->body_pool_.release(object);
 		}
-		if (this->debug_messages_) std::cerr << "Removed objects: "<<  it->first <<".\n";
+		if (this->debug_messages_) std::cerr << "Removed objects: "<<  this->object_table_.object_id_[handle] <<".\n";
+	}
+	if (permanent_removal)
+	{
+		this->object_table_.clear();
+		this->object_original_mass_prop_.clear();
 	}
-	if (permanent_removal) this->rigid_body_.clear();
 	this->object_best_pose_from_data_.clear();
 	if (this->debug_messages_) std::cerr << "Done removing all scene objects.\n";
 
-	mtx_.unlock();
+	this->releaseWorld();
 }
 
 void PhysicsEngine::cacheObjectVelocities(const btScalar &timeStep)
 {
 	btVector3 zero_vector(0,0,0);
-	for (std::map<std::string, btRigidBody*>::const_iterator it = this->rigid_body_.begin(); 
-		it != this->rigid_body_.end(); ++it)
+	// the velocities come from the previous tick, which may have used another time step
+	btScalar velocity_step = (this->quasi_static_active_ || this->adaptive_timestep_active_) ? 
+		this->previous_tick_step_ : timeStep;
+	ObjectBodyTable &table = this->object_table_;
+	for (std::size_t handle = 0; handle < table.size(); ++handle)
 	{
+		const btRigidBody* object = table.rigid_body_[handle];
 		// skips object that are not in the world
-		if (!it->second->isInWorld())
+		if (!isCollisionObjectEnabled(object))
 		{
 			continue;
 		}
 
-		btVector3 current_lin_vel = it->second->getLinearVelocity(),
-			current_ang_vel = it->second->getAngularVelocity();
+		btVector3 current_lin_vel = object->getLinearVelocity(),
+			current_ang_vel = object->getAngularVelocity();
 
 		// update the current object acceleration
-		if (keyExistInConstantMap(it->first,this->object_velocity_))
+		if (table.velocity_cached_[handle])
 		{
-			btVector3 avg_lin_acc = (current_lin_vel - object_velocity_[it->first].linear_)/ timeStep,
-				avg_ang_acc = (current_ang_vel - object_velocity_[it->first].angular_)/ timeStep;
+			btVector3 avg_lin_acc = (current_lin_vel - table.velocity_[handle].linear_)/ velocity_step,
+				avg_ang_acc = (current_ang_vel - table.velocity_[handle].angular_)/ velocity_step;
 
-			this->object_acceleration_[it->first].setValue(avg_lin_acc, avg_ang_acc);
+			table.acceleration_[handle].setValue(avg_lin_acc, avg_ang_acc);
+			table.acceleration_cached_[handle] = true;
 		}
 
-		// update the current object velocity
-		if (reset_obj_vel_every_frame_)
+		// update the current object velocity, the quasi-static relaxation stores the relaxed velocity
+		if (reset_obj_vel_every_frame_ || quasi_static_active_)
 		{
-			this->object_velocity_[it->first].setValue(zero_vector, zero_vector);
+			table.velocity_[handle].setValue(zero_vector, zero_vector);
 		}
 		else
 		{
-			this->object_velocity_[it->first].setValue(current_lin_vel, current_ang_vel);
+			table.velocity_[handle].setValue(current_lin_vel, current_ang_vel);
 		}
+		table.velocity_cached_[handle] = true;
 	}
 	// reset the object forces and velocity
-	if (reset_obj_vel_every_frame_) this->stopAllObjectMotion();
+	if (quasi_static_active_) this->relaxQuasiStaticVelocities(timeStep);
+	else if (reset_obj_vel_every_frame_) this->stopAllObjectMotion();
 }
 
 void PhysicsEngine::setSimulationMode(const int &simulation_mode, const double simulation_step,
@@ -601,9 +1042,56 @@ void PhysicsEngine::setDebugMode(bool debug)
 }
 
 
-void PhysicsEngine::renderingLaunched(const bool &flag)
+void PhysicsEngine::renderingLaunched(const bool &flag, const double &snapshots_per_second)
 {
+	mtx_.lock();
 	this->rendering_launched_ = flag;
+	this->render_publish_period_ = boost::posix_time::microseconds(
+		snapshots_per_second > 0 ? (long)(1e6 / snapshots_per_second) : 0);
+	this->last_render_publish_ = boost::posix_time::ptime(boost::posix_time::min_date_time);
+	// releasing the world publishes the current poses
+	this->releaseWorld();
+}
+
+bool PhysicsEngine::getRenderSnapshot(PhysicsEngineRenderSnapshot &snapshot, const unsigned long &last_version)
+{
+	boost::mutex::scoped_lock lock(render_mtx_);
+	const PhysicsEngineRenderSnapshot &front = this->render_buffers_[this->render_front_];
+	if (front.version_ == 0 || front.version_ == last_version) return false;
+	snapshot = front;
+	return true;
+}
+
+void PhysicsEngine::publishRenderSnapshot()
+{
+	PhysicsEngineRenderSnapshot &back = this->render_buffers_[1 - this->render_front_];
+	const btCollisionObjectArray &objects = m_dynamicsWorld->getCollisionObjectArray();
+	back.object_id_.clear();
+	back.shape_.clear();
+	back.pose_.clear();
+	back.activation_state_.clear();
+	for (int i = 0; i < objects.size(); i++)
+	{
+		// the disabled resident objects are not in the scene
+		if (!isCollisionObjectEnabled(objects[i])) continue;
+		back.object_id_.push_back(getObjectIDFromCollisionObject(objects[i]));
+		back.shape_.push_back(objects[i]->getCollisionShape());
+		back.pose_.push_back(objects[i]->getWorldTransform());
+		back.activation_state_.push_back(objects[i]->getActivationState());
+	}
+
+	// never wait for the renderer, the next publish fills the same back buffer
+	if (!render_mtx_.try_lock()) return;
+	back.version_ = ++this->render_version_;
+	this->render_front_ = 1 - this->render_front_;
+	render_mtx_.unlock();
+	this->last_render_publish_ = boost::posix_time::microsec_clock::universal_time();
+}
+
+void PhysicsEngine::getCameraPositionAndTarget(btVector3 &cam_position, btVector3 &cam_target) const
+{
+	cam_position = this->camera_coordinate_;
+	cam_target = this->target_coordinate_;
 }
 
 void PhysicsEngine::setFeedbackDataForcesGenerator(FeedbackDataForcesGenerator *data_forces_generator)
@@ -613,116 +1101,223 @@ void PhysicsEngine::setFeedbackDataForcesGenerator(FeedbackDataForcesGenerator *
 
 void PhysicsEngine::initPhysics()
 {
-	setTexturing(true);
-	setShadows(true);
-	m_broadphase = new btDbvtBroadphase();
+	this->createBroadphase();
 	m_collisionConfiguration = new btDefaultCollisionConfiguration();
-	m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
-	m_solver  = new btSequentialImpulseConstraintSolver;
-	m_dynamicsWorld = new btDiscreteDynamicsWorld(m_dispatcher, 
-		m_broadphase, m_solver, m_collisionConfiguration);
-	m_dynamicsWorld->setDebugDrawer(&gDebugDraw);
-	
-	m_dynamicsWorld->setInternalTickCallback(_worldTickCallback,static_cast<void *>(this),true);
+	this->createDynamicsWorld();
 }
 
-void PhysicsEngine::exitPhysics()
+void PhysicsEngine::createDynamicsWorld()
 {
-	// Clean up pointers
-	if (this->debug_messages_) std::cerr << "Shutting down physics engine.\n";
-	// delete all object contents
-	this->resetObjects(true);
-
-	// removes background
-	for (int i = 0; i < m_collisionShapes.size(); i++)
-		delete this->m_collisionShapes.at(0);
-	if (this->have_background_)
+#ifdef BT_THREADSAFE
+	if (this->world_thread_count_ > 1)
+	{
+		m_dispatcher = new btCollisionDispatcherMt(m_collisionConfiguration);
+		btConstraintSolverPoolMt* solver_pool = new btConstraintSolverPoolMt(this->world_thread_count_);
+		m_solver = solver_pool;
+		m_solver_mt_ = new btSequentialImpulseConstraintSolverMt;
+		m_dynamicsWorld = new SceneDynamicsWorldMt(m_dispatcher, 
+			m_broadphase, solver_pool, m_solver_mt_, m_collisionConfiguration);
+	}
+	else
+#endif
 	{
-		m_dynamicsWorld->removeRigidBody(this->background_);
-		delete this->background_->getMotionState();
-		delete this->background_;
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_solver  = new btSequentialImpulseConstraintSolver;
+		m_solver_mt_ = 0;
+		m_dynamicsWorld = new SceneDynamicsWorld(m_dispatcher, 
+			m_broadphase, m_solver, m_collisionConfiguration);
 	}
+	
+	m_dynamicsWorld->setInternalTickCallback(_worldTickCallback,static_cast<void *>(this),true);
+	if (this->obb_pair_culling_) m_dispatcher->setNearCallback(_obbCullingNearCallback);
+}
 
-	// delete physics world environment
-	if (this->debug_messages_) std::cerr << "Deleting physics engine environment.\n";
+void PhysicsEngine::deleteDynamicsWorld()
+{
 	delete m_dynamicsWorld;
+	delete this->m_solver_mt_;
 	delete this->m_solver;
 	delete this->m_dispatcher;
-	delete this->m_collisionConfiguration;
-	delete this->m_broadphase;
+	m_dynamicsWorld = 0;
+	m_solver_mt_ = 0;
+	m_solver = 0;
+	m_dispatcher = 0;
 }
 
-void	PhysicsEngine::clientResetScene()
+void PhysicsEngine::resetWorldLocalTime()
 {
-	exitPhysics();
-	initPhysics();
+#ifdef BT_THREADSAFE
+	if (this->world_thread_count_ > 1)
+	{
+		static_cast<SceneDynamicsWorldMt*>(m_dynamicsWorld)->resetLocalTime();
+		return;
+	}
+#endif
+	static_cast<SceneDynamicsWorld*>(m_dynamicsWorld)->resetLocalTime();
 }
 
-void PhysicsEngine::clientMoveAndDisplay()
+void PhysicsEngine::solveWorldContactsWithoutIntegration(const btScalar &time_step)
 {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
-
-	//simple dynamics world doesn't handle fixed-time-stepping
-	float ms = getDeltaTimeMicroseconds();
-	
-	///step the simulation
-	if (m_dynamicsWorld)
+#ifdef BT_THREADSAFE
+	if (this->world_thread_count_ > 1)
 	{
-		if (this->in_simulation_){
-			m_dynamicsWorld->stepSimulation(simulation_step_, 2, fixed_step_);
-		}
-		//optional but useful: debug drawing
-		m_dynamicsWorld->debugDrawWorld();
+		static_cast<SceneDynamicsWorldMt*>(m_dynamicsWorld)->solveContactsWithoutIntegration(time_step);
+		return;
 	}
-	
-	renderme(); 
-	glFlush();
-	swapBuffers();
+#endif
+	static_cast<SceneDynamicsWorld*>(m_dynamicsWorld)->solveContactsWithoutIntegration(time_step);
 }
 
-void PhysicsEngine::displayCallback(void)
+bool PhysicsEngine::setWorldThreadCount(const unsigned int &number_of_threads)
 {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
-	renderme();
+	unsigned int thread_count = number_of_threads > 0 ? number_of_threads : 1;
+#ifndef BT_THREADSAFE
+	if (thread_count > 1)
+	{
+		std::cerr << "Bullet multithreading is not enabled. Build Bullet and this package with BT_THREADSAFE "
+			<< "to use more than 1 world thread.\n";
+		return false;
+	}
+#endif
+	mtx_.lock();
+	if (thread_count == this->world_thread_count_)
+	{
+		this->releaseWorld();
+		return true;
+	}
+	if (m_dynamicsWorld->getNumCollisionObjects() > 0)
+	{
+		std::cerr << "The world thread count must be set before the background and the objects are added.\n";
+		this->releaseWorld();
+		return false;
+	}
+#ifdef BT_THREADSAFE
+	if (thread_count > 1 && !setBulletTaskSchedulerThreadCount(thread_count))
+	{
+		this->releaseWorld();
+		return false;
+	}
+#endif
 
-	//optional but useful: debug drawing to detect problems
-	if (m_dynamicsWorld)
-		m_dynamicsWorld->debugDrawWorld();
-	glFlush();
-	swapBuffers();
+	// keep the settings that were applied to the old world
+	btContactSolverInfo solver_info = m_dynamicsWorld->getSolverInfo();
+	btVector3 gravity = m_dynamicsWorld->getGravity();
 
-}
+	this->deleteDynamicsWorld();
+	this->world_thread_count_ = thread_count;
+	this->createDynamicsWorld();
 
+	m_dynamicsWorld->getSolverInfo() = solver_info;
+	m_dynamicsWorld->setGravity(gravity);
+	if (this->debug_messages_) std::cerr << "Using " << thread_count << " world thread(s).\n";
+	this->releaseWorld();
+	return true;
+}
 
-void PhysicsEngine::setCameraClippingPlaneNearFar(btScalar near, btScalar far)
+unsigned int PhysicsEngine::getWorldThreadCount() const
 {
-	this->m_frustumZNear = near;
-	this->m_frustumZFar = far;
+	return this->world_thread_count_;
 }
 
-void PhysicsEngine::setCameraPositionAndTarget(btVector3 cam_position, btVector3 cam_target)
+bool PhysicsEngine::setBroadphase(const int &broadphase_type, const btScalar &workspace_margin)
 {
-	this->m_cameraPosition = cam_position;
-	this->m_cameraTargetPosition = cam_target;
-	m_cameraDistance = m_cameraTargetPosition.distance(m_cameraPosition);
-	m_zoomStepSize = 0.05 * m_cameraDistance;
-	this->m_cameraPosition -= 0.5*(m_cameraPosition - m_cameraTargetPosition);
+	if (broadphase_type < DBVT_BROADPHASE || broadphase_type > BRUTE_FORCE_BROADPHASE)
+	{
+		std::cerr << "Unknown broadphase type " << broadphase_type << ".\n";
+		return false;
+	}
+	mtx_.lock();
+	if (m_dynamicsWorld->getNumCollisionObjects() > 0)
+	{
+		std::cerr << "The broadphase must be set before the background and the objects are added.\n";
+		this->releaseWorld();
+		return false;
+	}
+	this->broadphase_type_ = BroadphaseType(broadphase_type);
+	this->broadphase_workspace_margin_ = workspace_margin;
+	this->rebuildBroadphase();
+	this->releaseWorld();
+	return true;
+}
 
-	// calculate polar coordinate of the camera
-	btVector3 target_to_cam_direction = (m_cameraPosition - m_cameraTargetPosition).normalized();
-	this->m_ele = 90 - acos(target_to_cam_direction[1]) * 57.29577951308232;
-	this->m_azi = atan2(-target_to_cam_direction[0],-target_to_cam_direction[2]) * 57.29577951308232;
+void PhysicsEngine::createBroadphase()
+{
+	switch (this->broadphase_type_)
+	{
+		case AXIS_SWEEP_BROADPHASE:
+			m_broadphase = new btAxisSweep3(this->broadphase_aabb_min_, this->broadphase_aabb_max_);
+			break;
+		case BRUTE_FORCE_BROADPHASE:
+			m_broadphase = new btSimpleBroadphase();
+			break;
+		default:
+			m_broadphase = new btDbvtBroadphase();
+	}
 }
 
-void PhysicsEngine::setObjectPenaltyDatabase(std::map<std::string, ObjectPenaltyParameters> * penalty_database)
+void PhysicsEngine::rebuildBroadphase()
 {
-	this->object_penalty_parameter_database_ = penalty_database;
+	delete m_broadphase;
+	this->createBroadphase();
+	m_dynamicsWorld->setBroadphase(m_broadphase);
+	if (this->debug_messages_) std::cerr << "Using broadphase type " << this->broadphase_type_ << ".\n";
 }
 
-void PhysicsEngine::worldTickCallback(const btScalar &timeStep) {
-	mtx_.lock();
-	++world_tick_counter_;
-	this->cacheObjectVelocities(timeStep);
+void PhysicsEngine::fitBroadphaseToBackground(const btVector3 &aabb_min, const btVector3 &aabb_max)
+{
+	if (this->broadphase_type_ != AXIS_SWEEP_BROADPHASE) return;
+
+	btVector3 margin(1,1,1);
+	margin *= this->broadphase_workspace_margin_;
+	if (aabb_min - margin == this->broadphase_aabb_min_ && aabb_max + margin == this->broadphase_aabb_max_) return;
+	if (m_dynamicsWorld->getNumCollisionObjects() > 0)
+	{
+		std::cerr << "WARNING: The objects are already in the world, the broadphase keeps its previous bounds.\n";
+		return;
+	}
+	this->broadphase_aabb_min_ = aabb_min - margin;
+	this->broadphase_aabb_max_ = aabb_max + margin;
+	this->rebuildBroadphase();
+}
+
+void PhysicsEngine::exitPhysics()
+{
+	// Clean up pointers
+	if (this->debug_messages_) std::cerr << "Shutting down physics engine.\n";
+	// delete all object contents
+	this->resetObjects(true);
+
+	// removes background
+	this->removeBackground();
+	for (int i = 0; i < m_collisionShapes.size(); i++)
+		delete this->m_collisionShapes.at(i);
+	m_collisionShapes.clear();
+	this->body_pool_.clear();
+
+	// delete physics world environment
+	if (this->debug_messages_) std::cerr << "Deleting physics engine environment.\n";
+	this->deleteDynamicsWorld();
+	delete this->m_collisionConfiguration;
+	delete this->m_broadphase;
+}
+
+void PhysicsEngine::setObjectPenaltyDatabase(std::map<std::string, ObjectPenaltyParameters> * penalty_database)
+{
+	this->object_penalty_parameter_database_ = penalty_database;
+}
+
+void PhysicsEngine::worldTickCallback(const btScalar &timeStep) {
+	// runs on the thread that owns the world, so no lock is needed
+	++world_tick_counter_;
+	TimestepStatistics &statistics = this->timestep_statistics_;
+	statistics.min_step_ = statistics.number_of_ticks_ > 0 ? std::min(statistics.min_step_, timeStep) : timeStep;
+	statistics.max_step_ = std::max(statistics.max_step_, timeStep);
+	++statistics.number_of_ticks_;
+	statistics.simulated_time_ += timeStep;
+	// check the velocities before they are reset by cacheObjectVelocities
+	bool check_convergence = this->check_convergence_ || this->quasi_static_active_;
+	bool objects_settled = check_convergence && this->checkObjectsSettled(timeStep);
+	this->cacheObjectVelocities(timeStep);
 	// std::cerr << world_tick_counter_ << " " << this->number_of_world_tick_ << std::endl;
 
 	// calculate the scene analysis here
@@ -730,62 +1325,137 @@ void PhysicsEngine::worldTickCallback(const btScalar &timeStep) {
 		 (world_tick_counter_ >= this->number_of_world_tick_ || stop_simulation_after_have_support_graph_)
 		)
 	{
-		scene_graph_ = generateObjectSupportGraph(m_dynamicsWorld, 
-			this->vertex_map_, timeStep, gravity_vector_, this->debug_messages_);
-		// put the stability penalty into the scene graph
-		for (std::map<std::string, vertex_t>::const_iterator it = vertex_map_.begin(); 
-			it != this->vertex_map_.end(); ++it)
+		this->evaluateSceneGraph(timeStep);
+	}
+	else if (enable_data_forces_)
+	{
+		this->applyDataForces();
+	}
+	if (check_convergence) this->updateConvergenceStatus(objects_settled);
+	// the step chosen here is used from the next tick on
+	if (this->adaptive_timestep_active_) this->updateAdaptiveTimestep();
+
+	if (this->rendering_launched_ && boost::posix_time::microsec_clock::universal_time() - 
+		this->last_render_publish_ >= this->render_publish_period_)
+	{
+		this->publishRenderSnapshot();
+	}
+}
+
+void PhysicsEngine::evaluateSceneGraph(const btScalar &timeStep)
+{
+	scene_graph_ = generateObjectSupportGraph(m_dynamicsWorld, 
+		this->vertex_map_, timeStep, gravity_vector_, this->debug_messages_);
+	// put the stability penalty and the penetration before the depenetration pre-pass into the scene graph
+	for (std::map<std::string, vertex_t>::const_iterator it = vertex_map_.begin(); 
+		it != this->vertex_map_.end(); ++it)
+	{
+		std::size_t handle;
+		if (!this->object_table_.getHandle(it->first, handle)) continue;
+		scene_graph_[it->second].initial_penetration_distance_ = this->object_table_.initial_penetration_[handle];
+		if (this->object_table_.acceleration_cached_[handle])
 		{
-			if (keyExistInConstantMap(it->first,this->object_acceleration_))
+			scene_graph_[it->second].stability_penalty_ = calculateStabilityPenalty(
+				this->object_table_.acceleration_[handle], 
+				this->object_table_.penalty_parameters_[handle], gravity_magnitude_);
+
+			// if the object is really not stable, assume that it is not a ground supported vertices
+			if (scene_graph_[it->second].stability_penalty_ < 1e-4)
+			{
+				scene_graph_[it->second].ground_supported_ = false;
+				scene_graph_[it->second].distance_to_ground_ = 0;
+			}
+
+			double supp_contrib = getObjectSupportContribution(scene_graph_[it->second]);
+			if (debug_messages_)
 			{
-				scene_graph_[it->second].stability_penalty_ = calculateStabilityPenalty(
-					this->object_acceleration_[it->first], 
-					object_penalty_parameter_database_by_id_[it->first], gravity_magnitude_);
-
-				// if the object is really not stable, assume that it is not a ground supported vertices
-				if (scene_graph_[it->second].stability_penalty_ < 1e-4)
-				{
-					scene_graph_[it->second].ground_supported_ = false;
-					scene_graph_[it->second].distance_to_ground_ = 0;
-				}
-
-				double supp_contrib = getObjectSupportContribution(scene_graph_[it->second]);
-				if (debug_messages_)
-				{
-					std::cerr << it->first << ": " << " stability probability= " 
-					<< scene_graph_[it->second].stability_penalty_
-						<< ", support contribution probability= " << supp_contrib << std::endl;	
-				}
-				if (this->stop_simulation_after_have_support_graph_)
-				{
-					this->in_simulation_ = false;
-				}
+				std::cerr << it->first << ": " << " stability probability= " 
+				<< scene_graph_[it->second].stability_penalty_
+					<< ", support contribution probability= " << supp_contrib << std::endl;	
+			}
+			if (this->stop_simulation_after_have_support_graph_)
+			{
+				this->in_simulation_ = false;
 			}
 		}
 	}
-	else if (enable_data_forces_)
+}
+
+bool PhysicsEngine::checkObjectsSettled(const btScalar &timeStep) const
+{
+	// with velocity reset on each frame, a falling object only moves with the velocity gained from gravity in one tick
+	btScalar max_linear_velocity = std::min(this->convergence_criteria_.max_linear_velocity_, 
+		btScalar(0.5 * this->gravity_magnitude_ * timeStep));
+	for (std::vector<btRigidBody*>::const_iterator it = this->object_table_.rigid_body_.begin(); 
+		it != this->object_table_.rigid_body_.end(); ++it)
 	{
-		this->applyDataForces();
+		// skips object that are not in the world
+		if (!isCollisionObjectEnabled(*it) || (*it)->isStaticObject())
+		{
+			continue;
+		}
+
+		if ((*it)->getLinearVelocity().length() > max_linear_velocity ||
+			(*it)->getAngularVelocity().length() > this->convergence_criteria_.max_angular_velocity_)
+		{
+			return false;
+		}
+	}
+
+	return this->getMaxPenetrationDepth() <= this->convergence_criteria_.max_penetration_depth_;
+}
+
+btScalar PhysicsEngine::getMaxPenetrationDepth() const
+{
+	btScalar max_penetration_depth = 0;
+	for (int i = 0; i < m_dispatcher->getNumManifolds(); ++i)
+	{
+		const btPersistentManifold* manifold = m_dispatcher->getManifoldByIndexInternal(i);
+		for (int j = 0; j < manifold->getNumContacts(); ++j)
+		{
+			max_penetration_depth = std::max(max_penetration_depth, -manifold->getContactPoint(j).getDistance());
+		}
+	}
+	return max_penetration_depth;
+}
+
+void PhysicsEngine::updateConvergenceStatus(const bool &objects_settled)
+{
+	// the data forces are stable if their total magnitude stops changing
+	bool data_forces_stable = true;
+	if (this->enable_data_forces_)
+	{
+		btScalar data_forces_change = std::fabs(this->data_forces_magnitude_ - this->previous_data_forces_magnitude_);
+		data_forces_stable = this->previous_data_forces_magnitude_ >= 0 && data_forces_change <= 
+			this->convergence_criteria_.max_data_forces_change_ * std::max(this->data_forces_magnitude_, btScalar(1e-6));
+		this->previous_data_forces_magnitude_ = this->data_forces_magnitude_;
+	}
+
+	if (objects_settled && data_forces_stable) ++this->settled_tick_counter_;
+	else this->settled_tick_counter_ = 0;
+
+	if (this->settled_tick_counter_ >= this->convergence_criteria_.minimum_settled_ticks_)
+	{
+		this->simulation_converged_ = true;
 	}
-	mtx_.unlock();
 }
 
 void PhysicsEngine::stopAllObjectMotion()
 {
 	btVector3 zero_vector(0,0,0);
-	for (std::map<std::string, btRigidBody*>::const_iterator it = this->rigid_body_.begin(); 
-		it != this->rigid_body_.end(); ++it)
+	for (std::vector<btRigidBody*>::const_iterator it = this->object_table_.rigid_body_.begin(); 
+		it != this->object_table_.rigid_body_.end(); ++it)
 	{
 		// skips object that are not in the world
-		if (!it->second->isInWorld())
+		if (!isCollisionObjectEnabled(*it))
 		{
 			continue;
 		}
 
 		// reset the forces and velocity of the objects
-		// it->second->clearForces();
-		it->second->setLinearVelocity(zero_vector);
-		it->second->setAngularVelocity(zero_vector);
+		// (*it)->clearForces();
+		(*it)->setLinearVelocity(zero_vector);
+		(*it)->setAngularVelocity(zero_vector);
 	}
 }
 
@@ -797,38 +1467,98 @@ void PhysicsEngine::resetObjectMotionState(const bool &reset_object_pose,
 		it != target_pose_map.end(); ++it)
 	{
 		if (it->first == "background") continue;
-		else if (rigid_body_.find(it->first) == rigid_body_.end())
+		btRigidBody* object = this->getRigidBody(it->first);
+		if (!object)
 		{
 			std::cerr << "ERROR, object " << it->first << " has not been added yet.\n";
 			continue;
 		}
 		
 		// Reset the object pose to the original states
-		if (reset_object_pose) rigid_body_[it->first]->setWorldTransform(it->second);
+		if (reset_object_pose) object->setWorldTransform(it->second);
 
 		// reset the forces and velocity of the objects
-		// rigid_body_[it->first]->clearForces();
-		rigid_body_[it->first]->setLinearVelocity(zero_vector);
-		rigid_body_[it->first]->setAngularVelocity(zero_vector);
+		// object->clearForces();
+		object->setLinearVelocity(zero_vector);
+		object->setAngularVelocity(zero_vector);
 
 		// force the object to be active again
-		// rigid_body_[it->first]->activate(true);
+		// object->activate(true);
 	}
+	// the penetration of the previous poses must not be charged to the new ones
+	if (reset_object_pose) this->resetInitialPenetration();
 }
 
 SceneSupportGraph PhysicsEngine::getCurrentSceneGraph(std::map<std::string, vertex_t> &vertex_map)
 {
+	if (!this->in_simulation_)
+	{
+		// the world is only changed by a short command, wait for the current graph
+		mtx_.lock();
+	}
+	else if (!mtx_.try_lock())
+	{
+		// another thread is simulating, use the graph from its last simulation
+		boost::shared_ptr<const PhysicsEngineSnapshot> snapshot = boost::atomic_load(&this->snapshot_);
+		if (snapshot)
+		{
+			vertex_map = snapshot->vertex_map_;
+			return snapshot->scene_graph_;
+		}
+		mtx_.lock();
+	}
 	vertex_map = this->vertex_map_;
-	return this->scene_graph_;
+	SceneSupportGraph scene_graph = this->scene_graph_;
+	this->releaseWorld();
+	return scene_graph;
 }
 
-SceneSupportGraph PhysicsEngine::getUpdatedSceneGraph(std::map<std::string, vertex_t> &vertex_map)
+SceneSupportGraph PhysicsEngine::getUpdatedSceneGraph(std::map<std::string, vertex_t> &vertex_map,
+	const bool &poses_settled)
 {
+	if (this->contact_only_scene_graph_ && poses_settled) return this->getContactSceneGraph(vertex_map);
 	if (this->debug_messages_) std::cerr << "Getting updated scene graph.\n";
 	this->simulate();
 	return this->getCurrentSceneGraph(vertex_map);
 }
 
+SceneSupportGraph PhysicsEngine::getContactSceneGraph(std::map<std::string, vertex_t> &vertex_map)
+{
+	if (this->debug_messages_) std::cerr << "Getting scene graph from the current contacts.\n";
+	mtx_.lock();
+	// the objects start the solver pass from rest, like a tick of the velocity reset dynamics
+	this->object_table_.resetMotionHistory();
+	this->stopAllObjectMotion();
+	btVector3 zero_vector(0,0,0);
+	for (std::size_t handle = 0; handle < this->object_table_.size(); ++handle)
+	{
+		this->object_table_.velocity_[handle].setValue(zero_vector, zero_vector);
+		this->object_table_.velocity_cached_[handle] = true;
+	}
+
+	this->applyWarmStartContacts();
+	this->solveWorldContactsWithoutIntegration(fixed_step_);
+	this->world_tick_counter_ = 1;
+
+	// the accelerations come from the solved velocities, then the objects are put back at rest
+	bool reset_velocity = this->reset_obj_vel_every_frame_;
+	this->reset_obj_vel_every_frame_ = true;
+	this->cacheObjectVelocities(fixed_step_);
+	this->reset_obj_vel_every_frame_ = reset_velocity;
+
+	this->evaluateSceneGraph(fixed_step_);
+	vertex_map = this->vertex_map_;
+	SceneSupportGraph scene_graph = this->scene_graph_;
+	this->world_stepped_ = true;
+	this->releaseWorld();
+	return scene_graph;
+}
+
+void PhysicsEngine::setContactOnlySceneGraph(const bool &flag)
+{
+	this->contact_only_scene_graph_ = flag;
+}
+
 void PhysicsEngine::prepareSimulationForOneTestHypothesis(const std::string &object_id, const btTransform &object_pose,
 	const bool &resetObjectPosition)
 {
@@ -838,30 +1568,47 @@ void PhysicsEngine::prepareSimulationForOneTestHypothesis(const std::string &obj
 	object_test_pose_map_ = this->object_best_test_pose_map_;
 	object_test_pose_map_[object_id] = object_pose;
 	this->resetObjectMotionState(resetObjectPosition, object_test_pose_map_);
-	rigid_body_[object_id]->activate(true);
-	mtx_.unlock();
+	btRigidBody* object = this->getRigidBody(object_id);
+	if (object) object->activate(true);
+	this->releaseWorld();
 }
 
 void PhysicsEngine::prepareSimulationForWithBestTestPose()
 {
 	mtx_.lock();
 	this->resetObjectMotionState(true, object_best_test_pose_map_);
-	mtx_.unlock();
+	this->releaseWorld();
 }
 
 void PhysicsEngine::changeBestTestPoseMap(const std::string &object_id, const btTransform &object_pose)
 {
+	this->runWorldCommand(boost::bind(&PhysicsEngine::changeBestTestPoseCommand, this, object_id, object_pose));
+
+	// the cached icp result is updated here, since the queued command may run after the generator is replaced
 	mtx_.lock();
+	this->applyPendingCommands();
+	std::size_t handle;
+	if (this->data_forces_generator_ && this->object_table_.getHandle(object_id, handle))
+	{
+		this->data_forces_generator_->manualSetCachedIcpResultMapFromPose(object_pose,
+			this->object_table_.object_class_[handle], object_id);
+	}
+	this->releaseWorld();
+}
+
+void PhysicsEngine::changeBestTestPoseCommand(const std::string &object_id, const btTransform &object_pose)
+{
 	this->object_best_test_pose_map_[object_id] = object_pose;
-	data_forces_generator_->manualSetCachedIcpResultMapFromPose(object_pose,object_label_class_map_[object_id], object_id);
-	mtx_.unlock();
 }
 
 void PhysicsEngine::changeBestTestPoseMap(const std::map<std::string, btTransform> &object_best_pose_from_data)
 {
-	mtx_.lock();
+	this->runWorldCommand(boost::bind(&PhysicsEngine::changeBestTestPoseMapCommand, this, object_best_pose_from_data));
+}
+
+void PhysicsEngine::changeBestTestPoseMapCommand(const std::map<std::string, btTransform> &object_best_pose_from_data)
+{
 	this->object_best_test_pose_map_ = object_best_pose_from_data;
-	mtx_.unlock();
 }
 
 btTransform PhysicsEngine::getTransformOfBestData(const std::string &object_id, bool use_best_test_data) const
@@ -878,38 +1625,55 @@ btTransform PhysicsEngine::getTransformOfBestData(const std::string &object_id,
 
 void PhysicsEngine::setIgnoreDataForces(const std::string &object_id, bool value)
 {
-	this->ignored_data_forces_[object_id] = value;
+	this->runWorldCommand(boost::bind(&PhysicsEngine::setIgnoreDataForcesCommand, this, object_id, value));
+}
+
+void PhysicsEngine::setIgnoreDataForcesCommand(const std::string &object_id, const bool &value)
+{
+	std::size_t handle;
+	if (!this->object_table_.getHandle(object_id, handle))
+	{
+		std::cerr << "ERROR, object " << object_id << " has not been added yet.\n";
+		return;
+	}
+	this->object_table_.ignore_data_forces_[handle] = value;
 }
 
 void PhysicsEngine::makeObjectStatic(const std::string &object_id, const bool &make_static)
+{
+	this->runWorldCommand(boost::bind(&PhysicsEngine::makeObjectStaticCommand, this, object_id, make_static));
+}
+
+void PhysicsEngine::makeObjectStaticCommand(const std::string &object_id, const bool &make_static)
 {
 	// do nothing for invalid object
-	if (!keyExistInConstantMap(object_id, rigid_body_)) return;
-	else if (rigid_body_[object_id]->isStaticObject() && make_static) return;
+	std::size_t handle;
+	if (!this->object_table_.getHandle(object_id, handle)) return;
+	btRigidBody* object = this->object_table_.rigid_body_[handle];
+	if (object->isStaticObject() && make_static) return;
 
 	if (make_static)
 	{
-		object_original_data_forces_flag_[object_id] = ignored_data_forces_[object_id];
-		ignored_data_forces_[object_id] = false;
+		this->object_table_.original_ignore_data_forces_[handle] = this->object_table_.ignore_data_forces_[handle];
+		this->object_table_.ignore_data_forces_[handle] = false;
 	}
 	else
 	{
-		ignored_data_forces_[object_id] = object_original_data_forces_flag_[object_id];
+		this->object_table_.ignore_data_forces_[handle] = this->object_table_.original_ignore_data_forces_[handle];
 	}
 
-	this->makeStatic(*rigid_body_[object_id],make_static);
+	this->makeStatic(*object,make_static);
 }
 
 std::vector<std::string> PhysicsEngine::getAllActiveObjectIds() const
 {
 	std::vector<std::string> result;
-	for (std::map<std::string, btRigidBody*>::const_iterator it = this->rigid_body_.begin(); 
-		it != this->rigid_body_.end(); ++it)
+	for (std::size_t handle = 0; handle < this->object_table_.size(); ++handle)
 	{
 		// skips object that are not in the world
-		if (!it->second->isInWorld())
+		if (isCollisionObjectEnabled(this->object_table_.rigid_body_[handle]))
 		{
-			result.push_back(it->first);
+			result.push_back(this->object_table_.object_id_[handle]);
 		}
 	}
 	return result;
@@ -929,6 +1693,9 @@ void PhysicsEngine::makeStatic(btRigidBody &object, const bool &make_static)
 
 		object.setMassProps(0,zero_vector);
 		object.updateInertiaTensor();
+		// the dispatcher skips the pairs of two sleeping objects, so the static objects do not get contact points
+		// with each other. The static objects also never join the islands of the dynamic objects.
+		object.forceActivationState(ISLAND_SLEEPING);
 	}
 	else
 	{
@@ -950,28 +1717,601 @@ void PhysicsEngine::contactTest(btCollisionObject* col_object, btCollisionWorld:
 	m_dynamicsWorld->contactTest(col_object, result);
 }
 
-void PhysicsEngine::applyDataForces()
+void PhysicsEngine::mirrorWorldFrom(const PhysicsEngine &source)
 {
-	
-	// calculate data feedback forces to apply
-	for (std::map<std::string, btRigidBody*>::const_iterator it = this->rigid_body_.begin(); 
-		it != this->rigid_body_.end(); ++it)
+	// delete the previously mirrored objects
+	this->resetObjects(true);
+
+	mtx_.lock();
+	if (this->debug_messages_) std::cerr << "Mirroring the world of another physics engine.\n";
+	this->removeBackground();
+	if (this->broadphase_type_ != source.broadphase_type_ || this->broadphase_aabb_min_ != source.broadphase_aabb_min_ ||
+		this->broadphase_aabb_max_ != source.broadphase_aabb_max_)
 	{
+		// the world is empty now
+		this->broadphase_type_ = source.broadphase_type_;
+		this->broadphase_aabb_min_ = source.broadphase_aabb_min_;
+		this->broadphase_aabb_max_ = source.broadphase_aabb_max_;
+		this->rebuildBroadphase();
+	}
+	this->broadphase_workspace_margin_ = source.broadphase_workspace_margin_;
+	this->collision_detail_level_ = source.collision_detail_level_;
+	if (this->obb_pair_culling_ != source.obb_pair_culling_)
+	{
+		this->obb_pair_culling_ = source.obb_pair_culling_;
+		m_dispatcher->setNearCallback(this->obb_pair_culling_ ? _obbCullingNearCallback : 
+			btCollisionDispatcher::defaultNearCallback);
+	}
+
+	this->use_background_normal_as_gravity_ = source.use_background_normal_as_gravity_;
+	this->gravity_vector_ = source.gravity_vector_;
+	this->gravity_magnitude_ = source.gravity_magnitude_;
+	this->gravity_unit_vector_ = source.gravity_unit_vector_;
+	m_dynamicsWorld->setGravity(source.m_dynamicsWorld->getGravity());
+	m_dynamicsWorld->getSolverInfo() = source.m_dynamicsWorld->getSolverInfo();
+
+	if (source.have_background_)
+	{
+		// the background shape is owned by the source engine, so it is not added to m_collisionShapes
+		this->background_ = this->cloneRigidBody(*source.background_);
+		m_dynamicsWorld->addRigidBody(this->background_);
+		this->background_surface_normal_ = source.background_surface_normal_;
+		this->have_background_ = true;
+	}
+
+	// the mirrored objects keep the handles of the source objects
+	this->object_table_ = source.object_table_;
+	for (std::size_t handle = 0; handle < source.object_table_.size(); ++handle)
+	{
+		btRigidBody* source_object = source.object_table_.rigid_body_[handle];
+		btRigidBody* object = this->cloneRigidBody(*source_object);
+		this->setBodyCollisionDetail(object);
+		this->object_table_.rigid_body_[handle] = object;
+		if (keyExistInConstantMap(source_object, source.object_original_mass_prop_))
+		{
+			this->object_original_mass_prop_[object] = getContentOfConstantMap(source_object, source.object_original_mass_prop_);
+		}
+		if (isCollisionObjectEnabled(source_object)) m_dynamicsWorld->addRigidBody(object);
+	}
+	this->object_table_.resetMotionHistory();
+
+	this->object_best_pose_from_data_ = source.object_best_pose_from_data_;
+	this->object_best_test_pose_map_ = source.object_best_test_pose_map_;
+	this->object_penalty_parameter_database_ = source.object_penalty_parameter_database_;
+
+	this->reset_obj_vel_every_frame_ = source.reset_obj_vel_every_frame_;
+	this->stop_simulation_after_have_support_graph_ = source.stop_simulation_after_have_support_graph_;
+	this->simulation_step_ = source.simulation_step_;
+	this->fixed_step_ = source.fixed_step_;
+	this->number_of_world_tick_ = source.number_of_world_tick_;
+	this->convergence_criteria_ = source.convergence_criteria_;
+	this->quasi_static_settling_ = source.quasi_static_settling_;
+	this->quasi_static_parameters_ = source.quasi_static_parameters_;
+	this->adaptive_timestep_ = source.adaptive_timestep_;
+	this->adaptive_timestep_parameters_ = source.adaptive_timestep_parameters_;
+	this->depenetration_prepass_ = source.depenetration_prepass_;
+	this->depenetration_parameters_ = source.depenetration_parameters_;
+	this->depenetration_pending_ = false;
+	this->contact_only_scene_graph_ = source.contact_only_scene_graph_;
+	this->resident_bodies_ = source.resident_bodies_;
+	this->contact_warm_start_parameters_ = source.contact_warm_start_parameters_;
+	// the contacts of the previous world are not valid in the mirrored world
+	this->warm_start_contacts_ = WorldCheckpoint();
+	this->warm_start_object_ids_.clear();
+	this->previous_test_contacts_ = WorldCheckpoint();
+	this->previous_test_object_id_.clear();
+	this->releaseWorld();
+}
+
+void PhysicsEngine::resetWorldForTest(const std::map<std::string, btTransform> &object_pose_map)
+{
+	this->restoreWorldCheckpoint(WorldCheckpoint(object_pose_map));
+}
+
+WorldCheckpoint PhysicsEngine::captureWorldCheckpoint(const bool &include_contact_manifolds)
+{
+	WorldCheckpoint checkpoint;
+	mtx_.lock();
+	for (std::size_t handle = 0; handle < this->object_table_.size(); ++handle)
+	{
+		const btRigidBody* object = this->object_table_.rigid_body_[handle];
 		// skips object that are not in the world
-		if (!it->second->isInWorld())
+		if (!isCollisionObjectEnabled(object))
+		{
+			continue;
+		}
+
+		WorldCheckpoint::BodyState &body_state = checkpoint.body_state_[this->object_table_.object_id_[handle]];
+		body_state.transform_ = object->getCenterOfMassTransform();
+		body_state.linear_velocity_ = object->getLinearVelocity();
+		body_state.angular_velocity_ = object->getAngularVelocity();
+		body_state.activation_state_ = object->getActivationState();
+		body_state.deactivation_time_ = object->getDeactivationTime();
+	}
+	checkpoint.best_test_pose_map_ = this->object_best_test_pose_map_;
+
+	checkpoint.have_contact_manifolds_ = include_contact_manifolds;
+	checkpoint.collision_detail_level_ = this->collision_detail_level_;
+	if (include_contact_manifolds)
+	{
+		for (int i = 0; i < m_dispatcher->getNumManifolds(); ++i)
+		{
+			const btPersistentManifold* manifold = m_dispatcher->getManifoldByIndexInternal(i);
+			if (manifold->getNumContacts() == 0) continue;
+
+			std::vector<btManifoldPoint> &contact_points = checkpoint.contact_manifolds_[getContactManifoldKey(*manifold)];
+			for (int j = 0; j < manifold->getNumContacts(); ++j)
+			{
+				contact_points.push_back(manifold->getContactPoint(j));
+			}
+		}
+	}
+	this->releaseWorld();
+	return checkpoint;
+}
+
+void PhysicsEngine::restoreWorldCheckpoint(const WorldCheckpoint &checkpoint)
+{
+	mtx_.lock();
+	if (this->resident_bodies_)
+	{
+		// only switch off the objects that are not in the checkpoint, the broadphase keeps its proxies
+		for (std::size_t handle = 0; handle < this->object_table_.size(); ++handle)
+		{
+			if (!keyExistInConstantMap(this->object_table_.object_id_[handle], checkpoint.body_state_))
+			{
+				this->disableRigidBody(this->object_table_.rigid_body_[handle]);
+			}
+		}
+		// the contact points of the previous test must not warm start this one
+		for (int i = 0; i < m_dispatcher->getNumManifolds(); ++i)
 		{
+			m_dispatcher->getManifoldByIndexInternal(i)->clearManifold();
+		}
+	}
+	else
+	{
+		// empty the world, so the broadphase and the solver can be brought back to their initial state
+		for (std::vector<btRigidBody*>::iterator it = this->object_table_.rigid_body_.begin(); 
+			it != this->object_table_.rigid_body_.end(); ++it)
+		{
+			if ((*it)->isInWorld()) m_dynamicsWorld->removeRigidBody(*it);
+		}
+		if (this->have_background_) m_dynamicsWorld->removeRigidBody(this->background_);
+
+		m_broadphase->resetPool(m_dispatcher);
+
+		// add the bodies back in the same order every time
+		if (this->have_background_) m_dynamicsWorld->addRigidBody(this->background_);
+	}
+	m_solver->reset();
+	this->resetWorldLocalTime();
+
+	for (std::map<std::string, WorldCheckpoint::BodyState>::const_iterator it = checkpoint.body_state_.begin(); 
+		it != checkpoint.body_state_.end(); ++it)
+	{
+		btRigidBody* object = this->getRigidBody(it->first);
+		if (!object)
+		{
+			std::cerr << "ERROR, object " << it->first << " has not been added yet.\n";
+			continue;
+		}
+
+		const WorldCheckpoint::BodyState &body_state = it->second;
+		// velocities need to be set before the transform, since they are cached for interpolation
+		object->setLinearVelocity(body_state.linear_velocity_);
+		object->setAngularVelocity(body_state.angular_velocity_);
+		object->setCenterOfMassTransform(body_state.transform_);
+		object->getMotionState()->setWorldTransform(body_state.transform_);
+		object->clearForces();
+		this->enableRigidBody(object);
+		object->forceActivationState(body_state.activation_state_);
+		object->setDeactivationTime(body_state.deactivation_time_);
+	}
+	this->object_best_test_pose_map_ = checkpoint.best_test_pose_map_;
+	this->resetInitialPenetration();
+
+	if (checkpoint.have_contact_manifolds_ && checkpoint.collision_detail_level_ == this->collision_detail_level_)
+	{
+		// let the dispatcher create the manifolds of the overlapping objects, then put back the saved contact points
+		m_dynamicsWorld->performDiscreteCollisionDetection();
+		for (int i = 0; i < m_dispatcher->getNumManifolds(); ++i)
+		{
+			btPersistentManifold* manifold = m_dispatcher->getManifoldByIndexInternal(i);
+			if (manifold->getNumContacts() == 0) continue;
+
+			WorldCheckpoint::ContactManifoldKey key = getContactManifoldKey(*manifold);
+			if (!keyExistInConstantMap(key, checkpoint.contact_manifolds_)) continue;
+
+			const std::vector<btManifoldPoint> &contact_points = getContentOfConstantMap(key, checkpoint.contact_manifolds_);
+			manifold->clearManifold();
+			for (std::vector<btManifoldPoint>::const_iterator it = contact_points.begin(); it != contact_points.end(); ++it)
+			{
+				manifold->addManifoldPoint(*it);
+			}
+		}
+	}
+	this->releaseWorld();
+}
+
+void PhysicsEngine::setWarmStartContacts(const WorldCheckpoint &source, const std::set<std::string> &object_ids)
+{
+	mtx_.lock();
+	if (!source.have_contact_manifolds_) std::cerr << "WARNING: The warm start source has no contacts.\n";
+	this->warm_start_contacts_ = source;
+	this->warm_start_object_ids_ = object_ids;
+	this->releaseWorld();
+}
+
+void PhysicsEngine::setContactWarmStartParameters(const ContactWarmStartParameters &parameters)
+{
+	this->contact_warm_start_parameters_ = parameters;
+}
+
+void PhysicsEngine::saveTestContacts(const std::string &object_id)
+{
+	WorldCheckpoint contacts = this->captureWorldCheckpoint(true);
+	mtx_.lock();
+	this->previous_test_contacts_ = contacts;
+	this->previous_test_object_id_ = object_id;
+	this->releaseWorld();
+}
+
+bool PhysicsEngine::warmStartFromPreviousTest(const std::string &object_id)
+{
+	mtx_.lock();
+	bool have_contacts = !this->previous_test_object_id_.empty() && this->previous_test_object_id_ == object_id;
+	if (have_contacts)
+	{
+		this->warm_start_contacts_ = this->previous_test_contacts_;
+		this->warm_start_object_ids_.clear();
+		this->warm_start_object_ids_.insert(object_id);
+	}
+	this->releaseWorld();
+	return have_contacts;
+}
+
+void PhysicsEngine::applyWarmStartContacts()
+{
+	if (this->warm_start_object_ids_.empty()) return;
+	if (this->warm_start_contacts_.collision_detail_level_ != this->collision_detail_level_)
+	{
+		// the child shape indices of the saved contacts belong to other shapes
+		this->warm_start_contacts_ = WorldCheckpoint();
+		this->warm_start_object_ids_.clear();
+		return;
+	}
+
+	// create the manifolds of the objects that overlap at the current poses
+	m_dynamicsWorld->performDiscreteCollisionDetection();
+	const WorldCheckpoint &source = this->warm_start_contacts_;
+	const ContactWarmStartParameters &parameters = this->contact_warm_start_parameters_;
+	unsigned int number_of_warm_started_points = 0;
+	for (int i = 0; i < m_dispatcher->getNumManifolds(); ++i)
+	{
+		btPersistentManifold* manifold = m_dispatcher->getManifoldByIndexInternal(i);
+		if (manifold->getNumContacts() == 0) continue;
+
+		const btCollisionObject* object_0 = manifold->getBody0();
+		const btCollisionObject* object_1 = manifold->getBody1();
+		if (this->warm_start_object_ids_.find(getObjectIDFromCollisionObject(object_0)) == this->warm_start_object_ids_.end() &&
+			this->warm_start_object_ids_.find(getObjectIDFromCollisionObject(object_1)) == this->warm_start_object_ids_.end())
 			continue;
+
+		WorldCheckpoint::ContactManifoldKey key = getContactManifoldKey(*manifold);
+		if (!keyExistInConstantMap(key, source.contact_manifolds_)) continue;
+
+		// the contact geometry is only similar if the objects did not move much relative to each other
+		btTransform relative_pose_change = 
+			(getCheckpointTransform(source, object_0).inverseTimes(getCheckpointTransform(source, object_1))).inverseTimes(
+				object_0->getWorldTransform().inverseTimes(object_1->getWorldTransform()));
+		btScalar rotation_change = relative_pose_change.getRotation().getAngle();
+		if (rotation_change > SIMD_PI) rotation_change = SIMD_2_PI - rotation_change;
+		if (relative_pose_change.getOrigin().length() > parameters.max_relative_translation_ || 
+			rotation_change > parameters.max_relative_rotation_) continue;
+
+		// the new contact points keep their geometry, and take the impulses of the closest previous contact point
+		const std::vector<btManifoldPoint> &contact_points = getContentOfConstantMap(key, source.contact_manifolds_);
+		for (std::vector<btManifoldPoint>::const_iterator it = contact_points.begin(); it != contact_points.end(); ++it)
+		{
+			int point_idx = manifold->getCacheEntry(*it);
+			if (point_idx < 0) continue;
+			btManifoldPoint &contact_point = manifold->getContactPoint(point_idx);
+			contact_point.m_appliedImpulse = it->m_appliedImpulse;
+			contact_point.m_appliedImpulseLateral1 = it->m_appliedImpulseLateral1;
+			contact_point.m_appliedImpulseLateral2 = it->m_appliedImpulseLateral2;
+			++number_of_warm_started_points;
 		}
+	}
+	if (this->debug_messages_) std::cerr << "Warm started " << number_of_warm_started_points << " contact points.\n";
+
+	this->warm_start_contacts_ = WorldCheckpoint();
+	this->warm_start_object_ids_.clear();
+}
+
+std::map<std::string, btTransform> PhysicsEngine::getBestTestPoseMap() const
+{
+	return this->object_best_test_pose_map_;
+}
 
-		if (keyExistInConstantMap(it->first,ignored_data_forces_) && getContentOfConstantMap(it->first,ignored_data_forces_))
+void PhysicsEngine::runWorldCommand(const boost::function<void ()> &command)
+{
+	if (mtx_.try_lock())
+	{
+		// keep the order of the commands that are already queued
+		this->applyPendingCommands();
+		command();
+		this->releaseWorld();
+		return;
+	}
+
+	command_mtx_.lock();
+	this->pending_commands_.push_back(command);
+	this->commands_pending_.store(true, boost::memory_order_release);
+	command_mtx_.unlock();
+
+	// the owner may have released the world before the command was queued
+	if (mtx_.try_lock()) this->releaseWorld();
+}
+
+void PhysicsEngine::applyPendingCommands()
+{
+	if (!this->commands_pending_.load(boost::memory_order_acquire)) return;
+	std::deque<boost::function<void ()> > commands;
+	command_mtx_.lock();
+	commands.swap(this->pending_commands_);
+	this->commands_pending_.store(false, boost::memory_order_release);
+	command_mtx_.unlock();
+
+	for (std::deque<boost::function<void ()> >::const_iterator it = commands.begin(); it != commands.end(); ++it)
+	{
+		(*it)();
+	}
+}
+
+void PhysicsEngine::releaseWorld()
+{
+	while (true)
+	{
+		this->applyPendingCommands();
+		if (this->world_stepped_)
+		{
+			this->publishSnapshot();
+			this->world_stepped_ = false;
+		}
+		if (this->rendering_launched_) this->publishRenderSnapshot();
+		mtx_.unlock();
+
+		// take the world back if a command was queued while it was being released
+		if (!this->commands_pending_.load(boost::memory_order_acquire) || !mtx_.try_lock()) return;
+	}
+}
+
+void PhysicsEngine::publishSnapshot()
+{
+	boost::shared_ptr<PhysicsEngineSnapshot> snapshot(new PhysicsEngineSnapshot);
+	snapshot->object_poses_ = this->collectObjectPoses();
+	snapshot->scene_graph_ = this->scene_graph_;
+	snapshot->vertex_map_ = this->vertex_map_;
+	boost::atomic_store(&this->snapshot_, boost::shared_ptr<const PhysicsEngineSnapshot>(snapshot));
+}
+
+btRigidBody* PhysicsEngine::getRigidBody(const std::string &object_id) const
+{
+	std::size_t handle;
+	if (!this->object_table_.getHandle(object_id, handle)) return 0;
+	return this->object_table_.rigid_body_[handle];
+}
+
+btRigidBody* PhysicsEngine::cloneRigidBody(const btRigidBody &source_body)
+{
+	btScalar inv_mass = source_body.getInvMass();
+	btRigidBody::btRigidBodyConstructionInfo body_CI(inv_mass > 0 ? 1/inv_mass : 0, NULL,
+		const_cast<btCollisionShape*>(source_body.getCollisionShape()), source_body.getLocalInertia());
+	body_CI.m_friction = source_body.getFriction();
+	body_CI.m_rollingFriction = source_body.getRollingFriction();
+	body_CI.m_linearDamping = source_body.getLinearDamping();
+	body_CI.m_angularDamping = source_body.getAngularDamping();
+
+	// every body owns its name
+	return this->body_pool_.acquire(getObjectIDFromCollisionObject(&source_body), body_CI, 
+		source_body.getCenterOfMassTransform());
+}
+
+void PhysicsEngine::removeBackground()
+{
+	if (!this->have_background_) return;
+	m_dynamicsWorld->removeRigidBody(this->background_);
+	// the shapes created by this engine are deleted, a mirrored background shares the shape of its source
+	btCollisionShape* background_shape = this->background_->getCollisionShape();
+	if (m_collisionShapes.findLinearSearch(background_shape) < m_collisionShapes.size())
+	{
+		m_collisionShapes.remove(background_shape);
+		delete background_shape;
+	}
+	this->body_pool_.release(this->background_);
+	this->background_ = NULL;
+	this->have_background_ = false;
+}
+
+void PhysicsEngine::setObjectEvictionFrames(const unsigned int &number_of_frames)
+{
+	this->object_eviction_frames_ = number_of_frames;
+}
+
+void PhysicsEngine::evictMissingObjects(const std::set<std::string> &detected_objects, 
+	const std::set<std::string> &referenced_objects)
+{
+	ObjectBodyTable &table = this->object_table_;
+	for (std::size_t handle = 0; handle < table.size();)
+	{
+		const std::string object_id = table.object_id_[handle];
+		if (detected_objects.find(object_id) != detected_objects.end() || 
+			referenced_objects.find(object_id) != referenced_objects.end())
+		{
+			table.missing_frames_[handle] = 0;
+			++handle;
+			continue;
+		}
+		if (this->object_eviction_frames_ == 0 || ++table.missing_frames_[handle] <= this->object_eviction_frames_)
+		{
+			++handle;
+			continue;
+		}
+
+		if (this->debug_messages_) std::cerr << "Evicting object " << object_id << " after " 
+			<< this->object_eviction_frames_ << " missing frames.\n";
+		btRigidBody* object = table.rigid_body_[handle];
+		if (object->isInWorld()) m_dynamicsWorld->removeRigidBody(object);
+		this->object_original_mass_prop_.erase(object);
+		this->object_best_test_pose_map_.erase(object_id);
+		if (this->data_forces_generator_) this->data_forces_generator_->removeCachedIcpResult(object_id);
+		this->body_pool_.release(object);
+		// the last object takes this handle, so the handle is checked again
+		table.removeObject(handle);
+	}
+}
+
+void PhysicsEngine::setResidentBodies(const bool &flag)
+{
+	mtx_.lock();
+	this->resident_bodies_ = flag;
+	this->releaseWorld();
+}
+
+void PhysicsEngine::setCollisionDetailLevel(const int &detail_level)
+{
+	if (detail_level < 0 || detail_level >= NUMBER_OF_COLLISION_DETAIL_LEVELS)
+	{
+		std::cerr << "Invalid collision detail level " << detail_level << ".\n";
+		return;
+	}
+	mtx_.lock();
+	if (detail_level != this->collision_detail_level_)
+	{
+		this->collision_detail_level_ = detail_level;
+		for (std::vector<btRigidBody*>::iterator it = this->object_table_.rigid_body_.begin(); 
+			it != this->object_table_.rigid_body_.end(); ++it)
+		{
+			this->setBodyCollisionDetail(*it);
+		}
+	}
+	this->releaseWorld();
+}
+
+int PhysicsEngine::getCollisionDetailLevel() const
+{
+	return this->collision_detail_level_;
+}
+
+void PhysicsEngine::setObbPairCulling(const bool &flag)
+{
+	mtx_.lock();
+	this->obb_pair_culling_ = flag;
+	m_dispatcher->setNearCallback(flag ? _obbCullingNearCallback : btCollisionDispatcher::defaultNearCallback);
+	this->releaseWorld();
+}
+
+void PhysicsEngine::setBodyCollisionDetail(btRigidBody* object)
+{
+	const CollisionDetailShapes* detail_shapes = getCollisionDetailShapes(object);
+	if (!detail_shapes) return;
+	btCollisionShape* shape = detail_shapes->shapes_[this->collision_detail_level_];
+	if (object->getCollisionShape() == shape) return;
+
+	// the mass properties stay the ones of the full shape
+	object->setCollisionShape(shape);
+	btBroadphaseProxy* proxy = object->getBroadphaseHandle();
+	if (!proxy) return;
+	// the collision algorithms of the pairs were created for the previous shape
+	m_broadphase->getOverlappingPairCache()->cleanProxyFromPairs(proxy, m_dispatcher);
+	m_dynamicsWorld->updateSingleAabb(object);
+}
+
+// Adds the pairs of a proxy to the pair cache. The broadphase only looks for the new pairs of the proxies
+// that moved, so a proxy that is switched back on at the same place would not get its pairs back.
+struct ResidentProxyPairCallback : public btBroadphaseAabbCallback
+{
+	ResidentProxyPairCallback(btBroadphaseProxy* proxy, btOverlappingPairCache* pair_cache) : 
+		proxy_(proxy), pair_cache_(pair_cache) {}
+
+	virtual bool process(const btBroadphaseProxy* other_proxy)
+	{
+		// the pair cache skips the pairs that are filtered out or that already exist
+		if (other_proxy != proxy_) pair_cache_->addOverlappingPair(proxy_, const_cast<btBroadphaseProxy*>(other_proxy));
+		return true;
+	}
+
+	btBroadphaseProxy* proxy_;
+	btOverlappingPairCache* pair_cache_;
+};
+
+void PhysicsEngine::enableRigidBody(btRigidBody* object)
+{
+	if (!object->isInWorld())
+	{
+		m_dynamicsWorld->addRigidBody(object);
+		return;
+	}
+	if (object->getActivationState() != DISABLE_SIMULATION) return;
+
+	// same collision filter as btDiscreteDynamicsWorld::addRigidBody
+	btBroadphaseProxy* proxy = object->getBroadphaseHandle();
+	bool is_dynamic = !(object->isStaticObject() || object->isKinematicObject());
+	proxy->m_collisionFilterGroup = is_dynamic ? short(btBroadphaseProxy::DefaultFilter) : short(btBroadphaseProxy::StaticFilter);
+	proxy->m_collisionFilterMask = is_dynamic ? short(btBroadphaseProxy::AllFilter) : 
+		short(btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+	object->forceActivationState(ACTIVE_TAG);
+	object->setDeactivationTime(0);
+
+	m_dynamicsWorld->updateSingleAabb(object);
+	ResidentProxyPairCallback pair_callback(proxy, m_broadphase->getOverlappingPairCache());
+	m_broadphase->aabbTest(proxy->m_aabbMin, proxy->m_aabbMax, pair_callback);
+}
+
+void PhysicsEngine::disableRigidBody(btRigidBody* object)
+{
+	if (!isCollisionObjectEnabled(object)) return;
+	if (!this->resident_bodies_)
+	{
+		m_dynamicsWorld->removeRigidBody(object);
+		return;
+	}
+
+	btVector3 zero_vector(0,0,0);
+	object->setLinearVelocity(zero_vector);
+	object->setAngularVelocity(zero_vector);
+	object->clearForces();
+
+	// the empty filter keeps the broadphase from pairing the proxy again
+	btBroadphaseProxy* proxy = object->getBroadphaseHandle();
+	proxy->m_collisionFilterGroup = 0;
+	proxy->m_collisionFilterMask = 0;
+	m_broadphase->getOverlappingPairCache()->removeOverlappingPairsContainingProxy(proxy, m_dispatcher);
+	object->forceActivationState(DISABLE_SIMULATION);
+}
+
+void PhysicsEngine::applyDataForces()
+{
+	this->data_forces_magnitude_ = 0;
+	
+	// calculate data feedback forces to apply
+	const ObjectBodyTable &table = this->object_table_;
+	for (std::size_t handle = 0; handle < table.size(); ++handle)
+	{
+		btRigidBody* object = table.rigid_body_[handle];
+		// skips object that are not in the world
+		if (!isCollisionObjectEnabled(object) || table.ignore_data_forces_[handle])
 		{
 			continue;
 		}
 
-		if (it->second->getActivationState() != ISLAND_SLEEPING)
+		if (object->getActivationState() != ISLAND_SLEEPING)
 		{
-			// it->second->applyGravity();
-			this->data_forces_generator_->applyFeedbackForces(*(it->second),object_label_class_map_[it->first]);
+			// object->applyGravity();
+			std::pair<btVector3, btVector3> data_forces = this->data_forces_generator_->applyFeedbackForces(
+				*object,table.object_class_[handle]);
+			this->data_forces_magnitude_ += data_forces.first.length();
 		}
 	}
 }
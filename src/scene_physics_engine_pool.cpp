@@ -0,0 +1,98 @@
+#include "scene_physics_engine_pool.h"
+
+PhysicsEnginePool::~PhysicsEnginePool()
+{
+	this->deleteWorkers();
+}
+
+void PhysicsEnginePool::setNumberOfWorkers(const std::size_t &number_of_workers)
+{
+	this->number_of_workers_ = number_of_workers > 0 ? number_of_workers : 1;
+#if BT_BULLET_VERSION < 287
+	if (this->number_of_workers_ > 1)
+	{
+		std::cerr << "WARNING: The profiler of Bullet " << BT_BULLET_VERSION << " is not thread safe. "
+			<< "Bullet needs to be built with BT_NO_PROFILE to use more than one physics engine worker.\n";
+	}
+#endif
+	// the workers will be recreated on the next synchronization
+	if (this->workers_.size() != this->number_of_workers_) this->deleteWorkers();
+}
+
+std::size_t PhysicsEnginePool::getNumberOfWorkers() const
+{
+	return this->number_of_workers_;
+}
+
+void PhysicsEnginePool::setDebugMode(bool debug)
+{
+	this->debug_messages_ = debug;
+}
+
+void PhysicsEnginePool::synchronizeWorkers(const PhysicsEngine &source)
+{
+	if (this->debug_messages_) std::cerr << "Synchronizing " << this->number_of_workers_ << " physics engine workers.\n";
+	while (this->workers_.size() < this->number_of_workers_)
+	{
+		this->workers_.push_back(new PhysicsEngine());
+	}
+
+	for (std::vector<PhysicsEngine*>::iterator it = this->workers_.begin(); it != this->workers_.end(); ++it)
+	{
+		(*it)->mirrorWorldFrom(source);
+	}
+}
+
+void PhysicsEnginePool::runJobs(const std::size_t &number_of_jobs, const PhysicsEngineJob &job)
+{
+	if (this->workers_.empty())
+	{
+		std::cerr << "ERROR: physics engine workers have not been synchronized.\n";
+		return;
+	}
+	else if (number_of_jobs == 0) return;
+
+	this->next_job_index_ = 0;
+	std::size_t number_of_threads = std::min(this->workers_.size(), number_of_jobs);
+	if (number_of_threads == 1)
+	{
+		// no need to spawn a thread for a single worker
+		this->workerThread(this->workers_[0], number_of_jobs, &job);
+		return;
+	}
+
+	boost::thread_group worker_threads;
+	for (std::size_t i = 0; i < number_of_threads; ++i)
+	{
+		worker_threads.create_thread(boost::bind(&PhysicsEnginePool::workerThread, this,
+			this->workers_[i], number_of_jobs, &job));
+	}
+	worker_threads.join_all();
+}
+
+void PhysicsEnginePool::workerThread(PhysicsEngine *worker, const std::size_t number_of_jobs, const PhysicsEngineJob *job)
+{
+	std::size_t job_index;
+	while (this->getNextJobIndex(number_of_jobs, job_index))
+	{
+		(*job)(*worker, job_index);
+	}
+}
+
+bool PhysicsEnginePool::getNextJobIndex(const std::size_t &number_of_jobs, std::size_t &job_index)
+{
+	job_mtx_.lock();
+	bool have_job = this->next_job_index_ < number_of_jobs;
+	if (have_job) job_index = this->next_job_index_++;
+	job_mtx_.unlock();
+	return have_job;
+}
+
+void PhysicsEnginePool::deleteWorkers()
+{
+	for (std::vector<PhysicsEngine*>::iterator it = this->workers_.begin(); it != this->workers_.end(); ++it)
+	{
+		delete *it;
+	}
+	this->workers_.clear();
+}
@@ -0,0 +1,165 @@
+#include "scene_physics_engine_renderer.h"
+
+PhysicsEngineRenderer::PhysicsEngineRenderer(PhysicsEngine *physics_engine, const double &maximum_frame_rate) : 
+	physics_engine_(physics_engine), camera_coordinate_(0,0,0), target_coordinate_(0,0,0),
+	last_frame_time_(boost::posix_time::min_date_time)
+{
+	this->setMaximumFrameRate(maximum_frame_rate);
+	this->initPhysics();
+}
+
+PhysicsEngineRenderer::~PhysicsEngineRenderer()
+{
+	this->physics_engine_->renderingLaunched(false);
+	// the collision shapes belong to the engine and the object database
+	for (std::map<std::string, btCollisionObject*>::iterator it = this->display_objects_.begin(); 
+		it != this->display_objects_.end(); ++it)
+	{
+		m_dynamicsWorld->removeCollisionObject(it->second);
+		delete it->second;
+	}
+	delete m_dynamicsWorld;
+	m_dynamicsWorld = 0;
+	delete this->m_solver;
+	delete this->m_dispatcher;
+	delete this->m_collisionConfiguration;
+	delete this->m_broadphase;
+}
+
+void PhysicsEngineRenderer::initPhysics()
+{
+	setTexturing(true);
+	setShadows(true);
+	m_broadphase = new btDbvtBroadphase();
+	m_collisionConfiguration = new btDefaultCollisionConfiguration();
+	m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+	m_solver = new btSequentialImpulseConstraintSolver;
+	m_dynamicsWorld = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+	m_dynamicsWorld->setDebugDrawer(&gDebugDraw);
+	this->setCameraClippingPlaneNearFar(0.005f);
+	this->updateCameraFromEngine();
+}
+
+void PhysicsEngineRenderer::setMaximumFrameRate(const double &maximum_frame_rate)
+{
+	this->frame_period_ = boost::posix_time::microseconds(
+		maximum_frame_rate > 0 ? (long)(1e6 / maximum_frame_rate) : 0);
+	this->physics_engine_->renderingLaunched(true, maximum_frame_rate);
+}
+
+void PhysicsEngineRenderer::clientResetScene()
+{
+	// the display world follows the engine world, so it can not be rebuilt from the render window
+}
+
+void PhysicsEngineRenderer::clientMoveAndDisplay()
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// the engine simulates on its own thread, only draw its latest poses
+	this->waitForNextFrame();
+	if (m_dynamicsWorld)
+	{
+		this->updateObjectsFromEngine();
+		this->updateCameraFromEngine();
+		//optional but useful: debug drawing
+		m_dynamicsWorld->debugDrawWorld();
+	}
+
+	renderme();
+	glFlush();
+	swapBuffers();
+}
+
+void PhysicsEngineRenderer::displayCallback(void)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	renderme();
+
+	//optional but useful: debug drawing to detect problems
+	if (m_dynamicsWorld)
+		m_dynamicsWorld->debugDrawWorld();
+	glFlush();
+	swapBuffers();
+
+}
+
+void PhysicsEngineRenderer::setCameraClippingPlaneNearFar(btScalar near, btScalar far)
+{
+	this->m_frustumZNear = near;
+	this->m_frustumZFar = far;
+}
+
+void PhysicsEngineRenderer::setCameraPositionAndTarget(btVector3 cam_position, btVector3 cam_target)
+{
+	this->m_cameraPosition = cam_position;
+	this->m_cameraTargetPosition = cam_target;
+	m_cameraDistance = m_cameraTargetPosition.distance(m_cameraPosition);
+	m_zoomStepSize = 0.05 * m_cameraDistance;
+	this->m_cameraPosition -= 0.5*(m_cameraPosition - m_cameraTargetPosition);
+
+	// calculate polar coordinate of the camera
+	btVector3 target_to_cam_direction = (m_cameraPosition - m_cameraTargetPosition).normalized();
+	this->m_ele = 90 - acos(target_to_cam_direction[1]) * 57.29577951308232;
+	this->m_azi = atan2(-target_to_cam_direction[0],-target_to_cam_direction[2]) * 57.29577951308232;
+}
+
+void PhysicsEngineRenderer::updateCameraFromEngine()
+{
+	// the engine points the camera to the background when the background is added
+	btVector3 camera_coordinate, target_coordinate;
+	this->physics_engine_->getCameraPositionAndTarget(camera_coordinate, target_coordinate);
+	if (camera_coordinate == this->camera_coordinate_ && target_coordinate == this->target_coordinate_) return;
+	this->camera_coordinate_ = camera_coordinate;
+	this->target_coordinate_ = target_coordinate;
+	if (this->camera_coordinate_ != this->target_coordinate_)
+		this->setCameraPositionAndTarget(camera_coordinate_,target_coordinate_);
+}
+
+void PhysicsEngineRenderer::updateObjectsFromEngine()
+{
+	if (!this->physics_engine_->getRenderSnapshot(this->snapshot_, this->snapshot_.version_)) return;
+
+	std::map<std::string, btCollisionObject*> display_objects;
+	for (std::size_t i = 0; i < this->snapshot_.object_id_.size(); i++)
+	{
+		btCollisionObject* object;
+		std::map<std::string, btCollisionObject*>::iterator it = this->display_objects_.find(this->snapshot_.object_id_[i]);
+		if (it != this->display_objects_.end() && it->second->getCollisionShape() == this->snapshot_.shape_[i])
+		{
+			object = it->second;
+			this->display_objects_.erase(it);
+		}
+		else
+		{
+			object = new btCollisionObject();
+			object->setCollisionShape(const_cast<btCollisionShape*>(this->snapshot_.shape_[i]));
+			m_dynamicsWorld->addCollisionObject(object);
+		}
+		object->setWorldTransform(this->snapshot_.pose_[i]);
+		object->forceActivationState(this->snapshot_.activation_state_[i]);
+		display_objects[this->snapshot_.object_id_[i]] = object;
+	}
+
+	// objects that are no longer in the engine world
+	for (std::map<std::string, btCollisionObject*>::iterator it = this->display_objects_.begin(); 
+		it != this->display_objects_.end(); ++it)
+	{
+		m_dynamicsWorld->removeCollisionObject(it->second);
+		delete it->second;
+	}
+	this->display_objects_.swap(display_objects);
+}
+
+void PhysicsEngineRenderer::waitForNextFrame()
+{
+	// the idle callback redraws as fast as it can, which would take CPU time from the simulation
+	boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+	boost::posix_time::time_duration elapsed = now - this->last_frame_time_;
+	if (elapsed < this->frame_period_)
+	{
+		boost::this_thread::sleep(this->frame_period_ - elapsed);
+		now = boost::posix_time::microsec_clock::universal_time();
+	}
+	this->last_frame_time_ = now;
+}
@@ -99,7 +99,9 @@ btScalar getObjectSupportContribution(const scene_support_vertex_properties &sup
 btScalar getObjectCollisionPenalty(const scene_support_vertex_properties &support_graph_vertex)
 {
 	// TODO: Find a good parameter for the penetration depth
-	const double &total_penetration_depth = support_graph_vertex.penetration_distance_;
+	// the depenetration pre-pass must not hide the overlap of the hypothesis
+	const double total_penetration_depth = std::max(support_graph_vertex.penetration_distance_, 
+		support_graph_vertex.initial_penetration_distance_);
 	return logisticFunction(-1.5 , 1., 3., total_penetration_depth);
 	// return 1.;
 }
@@ -130,6 +130,183 @@ void assignAllConnectedToParentVertices(SceneSupportGraph &input_graph, const ve
     // }
 }
 
+static std::size_t findComponentRoot(std::vector<std::size_t> &component_parent, std::size_t idx)
+{
+    while (component_parent[idx] != idx)
+    {
+        component_parent[idx] = component_parent[component_parent[idx]];
+        idx = component_parent[idx];
+    }
+    return idx;
+}
+
+std::map<std::string, std::size_t> getSceneGraphComponents(const SceneSupportGraph &input_graph,
+    const std::map<std::string, vertex_t> &vertex_map, const btScalar &aabb_margin)
+{
+    std::map<std::string, std::size_t> result;
+    std::size_t number_of_vertices = boost::num_vertices(input_graph);
+    bool have_background = keyExistInConstantMap(std::string("background"), vertex_map);
+    vertex_t background_vertex = have_background ? getContentOfConstantMap(std::string("background"), vertex_map) : 0;
+
+    std::vector<std::size_t> component_parent(number_of_vertices);
+    for (std::size_t i = 0; i < number_of_vertices; i++) component_parent[i] = i;
+
+    boost::graph_traits<SceneSupportGraph>::edge_iterator ei, ei_end;
+    for (boost::tie(ei, ei_end) = boost::edges(input_graph); ei != ei_end; ++ei)
+    {
+        vertex_t source_vertex = boost::source(*ei, input_graph), target_vertex = boost::target(*ei, input_graph);
+        if (have_background && (source_vertex == background_vertex || target_vertex == background_vertex)) continue;
+        component_parent[findComponentRoot(component_parent, source_vertex)] = 
+            findComponentRoot(component_parent, target_vertex);
+    }
+
+    // objects that are close to each other may still collide, even if they do not support each other
+    std::vector<btAABB> vertex_aabb(number_of_vertices);
+    for (std::size_t i = 0; i < number_of_vertices; i++)
+    {
+        const scene_support_vertex_properties &vertex_property = input_graph[i];
+        if (vertex_property.collision_object_ == NULL) continue;
+        vertex_property.collision_object_->getCollisionShape()->getAabb(vertex_property.object_pose_, 
+            vertex_aabb[i].m_min, vertex_aabb[i].m_max);
+        vertex_aabb[i].increment_margin(aabb_margin);
+    }
+    for (std::size_t i = 0; i < number_of_vertices; i++)
+    {
+        if ((have_background && i == background_vertex) || input_graph[i].collision_object_ == NULL) continue;
+        for (std::size_t j = i + 1; j < number_of_vertices; j++)
+        {
+            if ((have_background && j == background_vertex) || input_graph[j].collision_object_ == NULL) continue;
+            if (vertex_aabb[i].has_collision(vertex_aabb[j]))
+            {
+                component_parent[findComponentRoot(component_parent, i)] = findComponentRoot(component_parent, j);
+            }
+        }
+    }
+
+    for (std::map<std::string, vertex_t>::const_iterator it = vertex_map.begin(); it != vertex_map.end(); ++it)
+    {
+        if (it->first == "background") continue;
+        result[it->first] = findComponentRoot(component_parent, it->second);
+    }
+    return result;
+}
+
+std::set<std::string> getObjectInfluenceRegion(const SceneSupportGraph &input_graph,
+    const std::map<std::string, vertex_t> &vertex_map, const std::string &object_id, const btScalar &aabb_margin)
+{
+    std::set<std::string> result;
+    if (!keyExistInConstantMap(object_id, vertex_map)) return result;
+
+    std::size_t number_of_vertices = boost::num_vertices(input_graph);
+    bool have_background = keyExistInConstantMap(std::string("background"), vertex_map);
+    vertex_t background_vertex = have_background ? getContentOfConstantMap(std::string("background"), vertex_map) : 0;
+    vertex_t object_vertex = getContentOfConstantMap(object_id, vertex_map);
+
+    // the graph is directed, so the supporting (parent) vertices are collected from the edge list
+    std::vector<std::vector<vertex_t> > parent_vertices(number_of_vertices);
+    boost::graph_traits<SceneSupportGraph>::edge_iterator ei, ei_end;
+    for (boost::tie(ei, ei_end) = boost::edges(input_graph); ei != ei_end; ++ei)
+    {
+        parent_vertices[boost::target(*ei, input_graph)].push_back(boost::source(*ei, input_graph));
+    }
+
+    std::vector<bool> in_region(number_of_vertices, false);
+    in_region[object_vertex] = true;
+
+    // support ancestors
+    std::vector<vertex_t> open_vertices(1, object_vertex);
+    while (!open_vertices.empty())
+    {
+        vertex_t current_vertex = open_vertices.back();
+        open_vertices.pop_back();
+        for (std::vector<vertex_t>::const_iterator it = parent_vertices[current_vertex].begin(); 
+            it != parent_vertices[current_vertex].end(); ++it)
+        {
+            if (in_region[*it] || (have_background && *it == background_vertex)) continue;
+            in_region[*it] = true;
+            open_vertices.push_back(*it);
+        }
+    }
+
+    // descendants
+    open_vertices.push_back(object_vertex);
+    while (!open_vertices.empty())
+    {
+        vertex_t current_vertex = open_vertices.back();
+        open_vertices.pop_back();
+        boost::graph_traits<SceneSupportGraph>::out_edge_iterator oi, oi_end;
+        for (boost::tie(oi, oi_end) = boost::out_edges(current_vertex, input_graph); oi != oi_end; ++oi)
+        {
+            vertex_t child_vertex = boost::target(*oi, input_graph);
+            if (in_region[child_vertex] || (have_background && child_vertex == background_vertex)) continue;
+            in_region[child_vertex] = true;
+            open_vertices.push_back(child_vertex);
+        }
+    }
+
+    // contact neighbors that do not support the object, e.g. objects leaning against it
+    const scene_support_vertex_properties &object_property = input_graph[object_vertex];
+    if (object_property.collision_object_ != NULL)
+    {
+        btAABB object_aabb;
+        object_property.collision_object_->getCollisionShape()->getAabb(object_property.object_pose_, 
+            object_aabb.m_min, object_aabb.m_max);
+        object_aabb.increment_margin(aabb_margin);
+        for (std::size_t i = 0; i < number_of_vertices; i++)
+        {
+            if (in_region[i] || (have_background && i == background_vertex) || input_graph[i].collision_object_ == NULL) continue;
+            btAABB vertex_aabb;
+            input_graph[i].collision_object_->getCollisionShape()->getAabb(input_graph[i].object_pose_, 
+                vertex_aabb.m_min, vertex_aabb.m_max);
+            if (object_aabb.has_collision(vertex_aabb)) in_region[i] = true;
+        }
+    }
+
+    for (std::size_t i = 0; i < number_of_vertices; i++)
+    {
+        if (in_region[i]) result.insert(input_graph[i].object_id_);
+    }
+    return result;
+}
+
+std::set<std::string> getObjectsOverlappingPoses(const SceneSupportGraph &input_graph,
+    const std::map<std::string, vertex_t> &vertex_map, const std::string &object_id,
+    const std::vector<btTransform> &object_poses, const btScalar &aabb_margin)
+{
+    std::set<std::string> result;
+    if (!keyExistInConstantMap(object_id, vertex_map)) return result;
+
+    const scene_support_vertex_properties &object_property = 
+        input_graph[getContentOfConstantMap(object_id, vertex_map)];
+    if (object_property.collision_object_ == NULL) return result;
+    const btCollisionShape* object_shape = object_property.collision_object_->getCollisionShape();
+
+    std::vector<btAABB> pose_aabb(object_poses.size());
+    for (std::size_t i = 0; i < object_poses.size(); i++)
+    {
+        object_shape->getAabb(object_poses[i], pose_aabb[i].m_min, pose_aabb[i].m_max);
+        pose_aabb[i].increment_margin(aabb_margin);
+    }
+
+    for (std::map<std::string, vertex_t>::const_iterator it = vertex_map.begin(); it != vertex_map.end(); ++it)
+    {
+        if (it->first == "background" || it->first == object_id) continue;
+        const scene_support_vertex_properties &vertex_property = input_graph[it->second];
+        if (vertex_property.collision_object_ == NULL) continue;
+
+        btAABB vertex_aabb;
+        vertex_property.collision_object_->getCollisionShape()->getAabb(vertex_property.object_pose_, 
+            vertex_aabb.m_min, vertex_aabb.m_max);
+        for (std::vector<btAABB>::const_iterator pose_it = pose_aabb.begin(); pose_it != pose_aabb.end(); ++pose_it)
+        {
+            if (!vertex_aabb.has_collision(*pose_it)) continue;
+            result.insert(it->first);
+            break;
+        }
+    }
+    return result;
+}
+
 btAABB getCollisionAABB(const btCollisionObject* obj, const btManifoldPoint &pt, const bool &is_body_0, int &shape_index)
 {
     btAABB shape_AABB;
@@ -184,6 +361,8 @@ SceneSupportGraph generateObjectSupportGraph(btDynamicsWorld *world,
         new_vertex_property.object_id_ = getObjectIDFromCollisionObject(new_vertex_property.collision_object_);
         // do not add unrecognized object to the scene graph
         if (new_vertex_property.object_id_ == "unrecognized_object") continue;
+        // nor the objects that are disabled in the world
+        if (!isCollisionObjectEnabled(new_vertex_property.collision_object_)) continue;
 
         new_vertex_property.object_pose_ = new_vertex_property.collision_object_->getWorldTransform();
         vertex_t new_vertex = boost::add_vertex(scene_support_graph);
@@ -64,6 +64,12 @@ void SequentialSceneHypothesis::setStaticObjectThreshold(const double &translati
 	max_static_object_rotation_ = rotation_degree * boost::math::constants::pi<double>()/180.;
 }
 
+void SequentialSceneHypothesis::setNumberOfHypothesesToAdd(const int &scene_change_mode, 
+	const int &number_of_hypotheses)
+{
+	num_of_hypotheses_to_add_each_action_[scene_change_mode] = number_of_hypotheses > 0 ? number_of_hypotheses : 0;
+}
+
 void SequentialSceneHypothesis::setCameraMatrix(const double &fx, const double &fy, const double &cx, const double &cy)
 {
 	Eigen::Matrix3d camera_intrinsic;
@@ -199,8 +199,29 @@ void SceneHypothesisAssessor::addNewObjectTransforms(const std::vector<ObjectWit
 	}
 	this->setObjectHypothesesMap(best_data_confidence_hypothesis);
 
+	// the sequential hypothesis may put back any object of the previous scenes, e.g. a hidden support
+	std::set<std::string> referenced_objects;
+	if (!this->current_scene_.is_empty)
+	{
+		const std::map<std::string, vertex_t> &previous_vertex_map = this->current_scene_.best_scene_hypothesis_.vertex_map_;
+		for (std::map<std::string, vertex_t>::const_iterator it = previous_vertex_map.begin(); 
+			it != previous_vertex_map.end(); ++it)
+		{
+			referenced_objects.insert(it->first);
+		}
+		for (OneFrameSceneHypotheses::const_iterator scene_it = this->current_scene_.beam_scene_hypotheses_.begin();
+			scene_it != this->current_scene_.beam_scene_hypotheses_.end(); ++scene_it)
+		{
+			for (std::map<std::string, vertex_t>::const_iterator it = scene_it->vertex_map_.begin(); 
+				it != scene_it->vertex_map_.end(); ++it)
+			{
+				referenced_objects.insert(it->first);
+			}
+		}
+	}
+
 	if (this->debug_messages_) std::cerr <<"Adding new objects into the scene graph.\n";
-	this->physics_engine_->addObjects(objects);
+	this->physics_engine_->addObjects(objects, referenced_objects);
 }
 
 std::map<std::string, ObjectParameter> SceneHypothesisAssessor::getCorrectedObjectTransform(
@@ -217,7 +238,7 @@ std::map<std::string, ObjectParameter> SceneHypothesisAssessor::getCorrectedObje
 	this->physics_engine_->setSimulationMode(RESET_VELOCITY_ON_EACH_FRAME,GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER),
 		GRAVITY_SCALE_COMPENSATION*3);
 	
-	this->physics_engine_->stepSimulationWithoutEvaluation(0.1 * GRAVITY_SCALE_COMPENSATION, 
+	this->settleSimulation(*this->physics_engine_, 0.1 * GRAVITY_SCALE_COMPENSATION, 
 		GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER));
 	this->getUpdatedSceneSupportGraph();
 
@@ -294,7 +315,7 @@ std::map<std::string, ObjectParameter> SceneHypothesisAssessor::getCorrectedObje
 			}
 		}
 
-		this->physics_engine_->stepSimulationWithoutEvaluation(0.15 * GRAVITY_SCALE_COMPENSATION, 
+		this->settleSimulation(*this->physics_engine_, 0.15 * GRAVITY_SCALE_COMPENSATION, 
 			GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER));
 		this->getUpdatedSceneSupportGraph();
 
@@ -308,14 +329,14 @@ std::map<std::string, ObjectParameter> SceneHypothesisAssessor::getCorrectedObje
 			{
 				this->physics_engine_->addExistingRigidBodyBackFromMap(it->first,original_pose_to_test[it->first]);
 			}
-			this->physics_engine_->stepSimulationWithoutEvaluation(0.15 * GRAVITY_SCALE_COMPENSATION, 
+			this->settleSimulation(*this->physics_engine_, 0.15 * GRAVITY_SCALE_COMPENSATION, 
 				GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER));
 		}
 
-		this->physics_engine_->stepSimulationWithoutEvaluation(0.15 * GRAVITY_SCALE_COMPENSATION, 
+		this->settleSimulation(*this->physics_engine_, 0.15 * GRAVITY_SCALE_COMPENSATION, 
 			GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER));
 
-		this->physics_engine_->stepSimulationWithoutEvaluation(0.5 * GRAVITY_SCALE_COMPENSATION, 
+		this->settleSimulation(*this->physics_engine_, 0.5 * GRAVITY_SCALE_COMPENSATION, 
 			GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER),false);
 
 		this->physics_engine_->setSimulationMode(RESET_VELOCITY_ON_EACH_FRAME,GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER),
@@ -418,6 +439,182 @@ SceneSupportGraph SceneHypothesisAssessor::getSceneGraphData(std::map<std::strin
 void SceneHypothesisAssessor::setDebug(bool debug)
 {
 	this->debug_messages_ = debug;
+	this->physics_engine_pool_.setDebugMode(debug);
+}
+
+void SceneHypothesisAssessor::setNumberOfEvaluationThreads(const std::size_t &number_of_threads)
+{
+	this->physics_engine_pool_.setNumberOfWorkers(number_of_threads);
+}
+
+void SceneHypothesisAssessor::setStopSimulationAtConvergence(const bool &flag)
+{
+	this->stop_simulation_at_convergence_ = flag;
+}
+
+void SceneHypothesisAssessor::setHypothesisPruning(const bool &flag)
+{
+	this->hypothesis_pruning_ = flag;
+}
+
+void SceneHypothesisAssessor::setHypothesisCandidateLimits(const int &static_object_limit, const int &object_limit, 
+	const double &min_confidence_ratio)
+{
+	this->static_object_hypothesis_limit_ = static_object_limit;
+	this->object_hypothesis_limit_ = object_limit;
+	this->min_hypothesis_confidence_ratio_ = min_confidence_ratio;
+}
+
+void SceneHypothesisAssessor::setSceneBeamWidth(const std::size_t &beam_width)
+{
+	this->scene_beam_width_ = beam_width > 0 ? beam_width : 1;
+}
+
+void SceneHypothesisAssessor::setHypothesisDeduplicationThreshold(const double &translation_meter, 
+	const double &rotation_degree)
+{
+	this->max_duplicate_hypothesis_translation_ = translation_meter;
+	this->max_duplicate_hypothesis_rotation_ = rotation_degree * boost::math::constants::pi<double>()/180.;
+}
+
+void SceneHypothesisAssessor::setHypothesisSimulationSchedule(const int &object_action, 
+	const std::vector<double> &promotion_fractions)
+{
+	this->hypothesis_promotion_fractions_[object_action] = promotion_fractions;
+}
+
+std::vector<double> SceneHypothesisAssessor::getHypothesisPromotionFractions(const int &object_action) const
+{
+	if (!keyExistInConstantMap(object_action, this->hypothesis_promotion_fractions_)) return std::vector<double>();
+	return getContentOfConstantMap(object_action, this->hypothesis_promotion_fractions_);
+}
+
+void SceneHypothesisAssessor::setEvaluationDeadline(const double &deadline_second)
+{
+	this->evaluation_deadline_ = deadline_second;
+}
+
+void SceneHypothesisAssessor::setSeparateSupportComponents(const bool &flag)
+{
+	this->separate_support_components_ = flag;
+}
+
+void SceneHypothesisAssessor::setFreezeOutsideInfluenceRegion(const bool &flag)
+{
+	this->freeze_outside_influence_region_ = flag;
+}
+
+void SceneHypothesisAssessor::setContactWarmStarting(const bool &flag)
+{
+	this->contact_warm_starting_ = flag;
+	if (!flag) this->previous_frame_contacts_ = WorldCheckpoint();
+}
+
+void SceneHypothesisAssessor::setEarlyRankingCollisionDetail(const int &detail_level)
+{
+	if (detail_level < 0 || detail_level >= NUMBER_OF_COLLISION_DETAIL_LEVELS)
+	{
+		std::cerr << "Invalid collision detail level " << detail_level << ", using the full shapes.\n";
+		this->early_ranking_collision_detail_ = COLLISION_DETAIL_FULL;
+		return;
+	}
+	this->early_ranking_collision_detail_ = detail_level;
+}
+
+void SceneHypothesisAssessor::setHypothesisSimulationBudget(const unsigned int &simulation_ticks)
+{
+	this->hypothesis_simulation_budget_ = simulation_ticks;
+}
+
+void SceneHypothesisAssessor::setNumberOfPreviousHypotheses(const int &object_action, const int &number_of_hypotheses)
+{
+	this->sequential_scene_hypothesis_.setNumberOfHypothesesToAdd(object_action, number_of_hypotheses);
+}
+
+std::map<std::string, bool> SceneHypothesisAssessor::getObjectEvaluationStatus() const
+{
+	return this->current_scene_.object_fully_evaluated_;
+}
+
+bool SceneHypothesisAssessor::checkEvaluationDeadlineReached() const
+{
+	if (this->evaluation_deadline_ <= 0) return false;
+	boost::posix_time::time_duration elapsed_time = boost::posix_time::microsec_clock::universal_time() - 
+		this->evaluation_start_time_;
+	return elapsed_time.total_microseconds() > this->evaluation_deadline_ * 1e6;
+}
+
+double SceneHypothesisAssessor::getObjectSimulationBudgetWeight(const AdditionalHypotheses &object_hypotheses, 
+	const std::size_t &support_depth) const
+{
+	// effective number of competing hypotheses: equal data confidences count fully, 
+	// while a hypothesis far below the best one barely counts
+	const std::vector<double> &data_confidences = object_hypotheses.data_confidences_;
+	double competing_hypotheses = object_hypotheses.poses_.size();
+	if (data_confidences.size() == object_hypotheses.poses_.size() && !data_confidences.empty())
+	{
+		double best_confidence = *std::max_element(data_confidences.begin(), data_confidences.end());
+		if (best_confidence > 0)
+		{
+			competing_hypotheses = 0;
+			for (std::vector<double>::const_iterator it = data_confidences.begin(); it != data_confidences.end(); ++it)
+				competing_hypotheses += *it / best_confidence;
+		}
+	}
+
+	// static objects used to be limited to a third of the hypotheses of the changed objects
+	double action_weight = object_hypotheses.object_action_ == STATIC_OBJECT ? 1. : 3.;
+
+	// objects near the ground carry the objects above them, so their mistakes spread further
+	double support_weight = 1. + 1. / (1. + support_depth);
+
+	return competing_hypotheses * action_weight * support_weight;
+}
+
+unsigned int SceneHypothesisAssessor::getNumberOfSimulatedTicks(
+	const std::vector<ObjectHypothesisTestResult> &test_results)
+{
+	unsigned int number_of_ticks = 0;
+	for (std::vector<ObjectHypothesisTestResult>::const_iterator it = test_results.begin(); it != test_results.end(); ++it)
+		number_of_ticks += it->number_of_ticks_;
+	return number_of_ticks;
+}
+
+std::map<std::string, ObjectHypothesesEvaluationReport> SceneHypothesisAssessor::getHypothesesEvaluationReport() const
+{
+	return this->current_scene_.hypotheses_evaluation_report_;
+}
+
+double SceneHypothesisAssessor::getSceneProbabilityUpperBound(
+	const std::map<std::string, double> &left_out_object_probabilities)
+{
+	// the simulated objects may reach a probability of 1, while the left out objects keep their probability
+	std::vector<double> object_probabilities;
+	for (std::map<std::string, double>::const_iterator it = left_out_object_probabilities.begin(); 
+		it != left_out_object_probabilities.end(); ++it)
+	{
+		object_probabilities.push_back(it->second);
+	}
+	// the bound is only used after the object is background supported, where zero probabilities are not skipped
+	bool background_support_status = true;
+	return composeSceneProbability(object_probabilities, background_support_status);
+}
+
+bool SceneHypothesisAssessor::checkHypothesisPruned(const double &upper_bound, const bool &background_support_status,
+	const std::vector<SceneBeamCandidate> &beam_candidates) const
+{
+	// the bound only holds when an object with zero probability is not skipped from the scene 
+	// probability, which is after the background support status is set
+	if (!this->hypothesis_pruning_ || !background_support_status) return false;
+
+	std::size_t number_of_better_candidates = 0;
+	for (std::vector<SceneBeamCandidate>::const_iterator cand_it = beam_candidates.begin(); 
+		cand_it != beam_candidates.end(); ++cand_it)
+	{
+		if (cand_it->background_support_status_ && upper_bound <= cand_it->scene_probability_)
+			++number_of_better_candidates;
+	}
+	return number_of_better_candidates >= this->scene_beam_width_;
 }
 
 void SceneHypothesisAssessor::getCurrentSceneSupportGraph()
@@ -430,6 +627,17 @@ void SceneHypothesisAssessor::getUpdatedSceneSupportGraph()
 	this->scene_support_graph_ = this->physics_engine_->getUpdatedSceneGraph(this->vertex_map_);
 }
 
+unsigned int SceneHypothesisAssessor::settleSimulation(PhysicsEngine &physics_engine, const double &delta_time, 
+	const double &simulation_step, const bool &data_forces_enabled) const
+{
+	if (this->stop_simulation_at_convergence_)
+	{
+		return physics_engine.stepSimulationUntilConvergence(delta_time, simulation_step, data_forces_enabled);
+	}
+	physics_engine.stepSimulationWithoutEvaluation(delta_time, simulation_step, data_forces_enabled);
+	return physics_engine.getNumberOfSimulatedTicks();
+}
+
 void SceneHypothesisAssessor::setObjectHypothesesMap(std::map<std::string, ObjectHypothesesData > &object_hypotheses_map)
 {
 	this->object_hypotheses_map_ = object_hypotheses_map;
@@ -437,16 +645,26 @@ void SceneHypothesisAssessor::setObjectHypothesesMap(std::map<std::string, Objec
 
 double SceneHypothesisAssessor::evaluateObjectProbability(const std::string &object_label, 
 	const std::string &object_model_name, const int &object_action, const bool &verbose)
+{
+	return this->evaluateObjectProbability(this->scene_support_graph_, this->vertex_map_, this->data_forces_generator_,
+		this->physics_engine_->getGravityDirection(), object_label, object_model_name, object_action, verbose, std::cerr);
+}
+
+double SceneHypothesisAssessor::evaluateObjectProbability(const SceneSupportGraph &scene_support_graph,
+	const std::map<std::string, vertex_t> &vertex_map, FeedbackDataForcesGenerator &data_forces_generator,
+	const btVector3 &gravity_direction, const std::string &object_label, 
+	const std::string &object_model_name, const int &object_action,
+	const bool &verbose, std::ostream &verbose_output) const
 {
 	// std::cerr << "Accessing support graph data.\n";
-	vertex_t object_in_graph = this->vertex_map_[object_label];
-	scene_support_vertex_properties &object_physics_status = this->scene_support_graph_[object_in_graph];
-	btTransform &object_pose = object_physics_status.object_pose_;
+	vertex_t object_in_graph = getContentOfConstantMap(object_label, vertex_map);
+	const scene_support_vertex_properties &object_physics_status = scene_support_graph[object_in_graph];
+	const btTransform &object_pose = object_physics_status.object_pose_;
 	if (!object_physics_status.ground_supported_)
 	{
 		if (verbose)
 		{
-			std::cerr << object_label << " is skipped because it is not supported by the ground.\n";
+			verbose_output << object_label << " is skipped because it is not supported by the ground.\n";
 			// return 0;
 		}
 	}
@@ -458,7 +676,7 @@ double SceneHypothesisAssessor::evaluateObjectProbability(const std::string &obj
 	
 	// std::cerr << "Calculating data match probability criterion.\n";
 	// double ransac_confidence = this->data_probability_check_.getConfidence(object_model_name, object_pose);
-	double ransac_confidence = this->data_forces_generator_.getIcpConfidenceResult(object_model_name, object_pose);
+	double ransac_confidence = data_forces_generator.getIcpConfidenceResult(object_model_name, object_pose);
 
 	// ignore data compliance if it is support retained object
 	double object_data_compliance = object_action != SUPPORT_RETAINED_OBJECT ? 
@@ -467,8 +685,9 @@ double SceneHypothesisAssessor::evaluateObjectProbability(const std::string &obj
 	double obj_transition_probability;
 	if (keyExistInConstantMap(object_label,obj_previous_frame_pose_))
 	{
-		obj_transition_probability = calculateFrameTransitionPenalty(object_pose,obj_previous_frame_pose_[object_label],
-			this->physics_engine_->getGravityDirection(),
+		obj_transition_probability = calculateFrameTransitionPenalty(object_pose,
+			getContentOfConstantMap(object_label,obj_previous_frame_pose_),
+			gravity_direction,
 			0.5,1.);
 	}
 	else
@@ -481,7 +700,7 @@ double SceneHypothesisAssessor::evaluateObjectProbability(const std::string &obj
 
 	if (verbose)
 	{
-		std::cerr << "Probability =  " <<  object_total_probability << "; "
+		verbose_output << "Probability =  " <<  object_total_probability << "; "
 			<< "object_data_compliance = " << object_data_compliance<< ", "
 			<< "data = " << ransac_confidence << ", "
 			<< "stability = " << stability_probability << ", "
@@ -494,16 +713,33 @@ double SceneHypothesisAssessor::evaluateObjectProbability(const std::string &obj
 	return object_total_probability;
 }
 
-double SceneHypothesisAssessor::evaluateSceneOnObjectHypothesis(std::map<std::string, btTransform> &object_pose_from_graph, 
-	const std::string &object_label, const std::string &object_model_name, bool &background_support_status,
-	const btTransform &object_pose_hypothesis, const int &object_action, const bool &reset_position)
+std::vector<double> SceneHypothesisAssessor::evaluateSceneOnObjectHypothesis(PhysicsEngine &physics_engine,
+	FeedbackDataForcesGenerator &data_forces_generator, ObjectHypothesisTestResult &test_result,
+	const std::string &object_label, const btTransform &object_pose_hypothesis, 
+	const int &object_action, const bool &reset_position, 
+	const std::map<std::string, double> &outside_object_probabilities, const std::set<std::string> &frozen_objects,
+	std::ostream &verbose_output) const
 {
-	this->physics_engine_->prepareSimulationForOneTestHypothesis(object_label, object_pose_hypothesis, reset_position);
-	this->getUpdatedSceneSupportGraph();
+	physics_engine.prepareSimulationForOneTestHypothesis(object_label, object_pose_hypothesis, reset_position);
+	// the placed hypothesis has not settled yet, so its graph needs the simulated window
+	test_result.scene_support_graph_ = physics_engine.getUpdatedSceneGraph(test_result.vertex_map_, !reset_position);
+	test_result.number_of_ticks_ += physics_engine.getNumberOfSimulatedTicks();
+
+	// frozen objects that touch the tested object may still change their support, so they are evaluated again
+	std::set<std::string> touching_objects;
+	if (!frozen_objects.empty() && keyExistInConstantMap(object_label, test_result.vertex_map_))
+	{
+		const vertex_t tested_vertex = getContentOfConstantMap(object_label, test_result.vertex_map_);
+		touching_objects = getObjectsOverlappingPoses(test_result.scene_support_graph_, test_result.vertex_map_,
+			object_label, std::vector<btTransform>(1, test_result.scene_support_graph_[tested_vertex].object_pose_), 
+			0.01 * SCALING);
+	}
 
-	double scene_hypothesis = 1;
-	for (std::map<std::string, vertex_t>::iterator it = this->vertex_map_.begin();
-		it != this->vertex_map_.end(); ++it)
+	// objects that are not in the simulated world use their last evaluated probability
+	std::map<std::string, double> scene_object_probabilities = outside_object_probabilities;
+	test_result.object_probability_map_.clear();
+	for (std::map<std::string, vertex_t>::const_iterator it = test_result.vertex_map_.begin();
+		it != test_result.vertex_map_.end(); ++it)
 	{
 		if (it->first == "background") continue;
 
@@ -513,12 +749,38 @@ double SceneHypothesisAssessor::evaluateSceneOnObjectHypothesis(std::map<std::st
 		// only check probability for object that are exist in the dictionary
 		if (object_label_class_map.find(it->first) == object_label_class_map.end()) continue;
 
-		double obj_probability = this->evaluateObjectProbability(it->first, object_label_class_map[it->first],
-			object_action, verbose);
+		// frozen objects did not move, so their last evaluated probability still holds unless the tested object
+		// touches them
+		test_result.object_pose_from_graph_[it->first] = test_result.scene_support_graph_[it->second].object_pose_;
+		if (frozen_objects.find(it->first) != frozen_objects.end() &&
+			touching_objects.find(it->first) == touching_objects.end() &&
+			keyExistInConstantMap(it->first, outside_object_probabilities)) continue;
+
+		double obj_probability = this->evaluateObjectProbability(test_result.scene_support_graph_, 
+			test_result.vertex_map_, data_forces_generator, physics_engine.getGravityDirection(),
+			it->first, getContentOfConstantMap(it->first, object_label_class_map), object_action, verbose, verbose_output);
 
-		vertex_t &object_in_graph = this->vertex_map_[it->first];
-		object_pose_from_graph[it->first] = this->scene_support_graph_[object_in_graph].object_pose_;
+		test_result.object_probability_map_[it->first] = obj_probability;
+		scene_object_probabilities[it->first] = obj_probability;
+	}
 
+	std::vector<double> object_probabilities;
+	object_probabilities.reserve(scene_object_probabilities.size());
+	for (std::map<std::string, double>::const_iterator it = scene_object_probabilities.begin(); 
+		it != scene_object_probabilities.end(); ++it)
+	{
+		object_probabilities.push_back(it->second);
+	}
+	return object_probabilities;
+}
+
+double SceneHypothesisAssessor::composeSceneProbability(const std::vector<double> &object_probabilities,
+	bool &background_support_status)
+{
+	double scene_hypothesis = 1;
+	for (std::vector<double>::const_iterator it = object_probabilities.begin(); it != object_probabilities.end(); ++it)
+	{
+		const double &obj_probability = *it;
 		if (obj_probability == 0)
 		{
 			if (background_support_status)
@@ -542,8 +804,339 @@ double SceneHypothesisAssessor::evaluateSceneOnObjectHypothesis(std::map<std::st
 	return scene_hypothesis;
 }
 
+void SceneHypothesisAssessor::settleWorldForTest(PhysicsEngine &physics_engine, const std::size_t &beam_idx,
+	const std::vector<SceneBeam> &beams, const std::vector<map_string_transform> &beam_test_pose_maps,
+	std::vector<WorldCheckpoint> &settled_worlds, std::vector<unsigned int> &settle_ticks) const
+{
+	const SceneBeam &beam = beams[beam_idx];
+	FeedbackDataForcesGenerator data_forces_generator = beam.data_forces_generator_;
+	physics_engine.setFeedbackDataForcesGenerator(&data_forces_generator);
+	physics_engine.resetWorldForTest(beam_test_pose_maps[beam_idx]);
+	if (this->contact_warm_starting_ && !this->frame_warm_start_objects_.empty())
+	{
+		physics_engine.setWarmStartContacts(this->previous_frame_contacts_, this->frame_warm_start_objects_);
+	}
+
+	settle_ticks[beam_idx] = this->settleSimulation(physics_engine, .15 * GRAVITY_SCALE_COMPENSATION, 
+		GRAVITY_SCALE_COMPENSATION/120.);
+	settle_ticks[beam_idx] += this->settleSimulation(physics_engine, .1 * GRAVITY_SCALE_COMPENSATION, 
+		GRAVITY_SCALE_COMPENSATION/120.,false);
+
+	// keep the contact points, the object poses will be reset to the base poses at the start of each test
+	settled_worlds[beam_idx] = physics_engine.captureWorldCheckpoint(true);
+	physics_engine.setFeedbackDataForcesGenerator(NULL);
+}
+
+void SceneHypothesisAssessor::testObjectHypothesis(PhysicsEngine &physics_engine, const std::size_t &job_idx,
+	const std::vector<std::size_t> &test_indices, const std::vector<ObjectHypothesisTest> &hypothesis_tests, 
+	const std::vector<SceneBeam> &beams, const std::vector<WorldCheckpoint> &settled_worlds, 
+	const ObjectTestScope &test_scope, std::vector<ObjectHypothesisTestResult> &test_results) const
+{
+	const map_string_transform &child_pose_map = test_scope.child_pose_map_;
+	const std::size_t &test_idx = test_indices[job_idx];
+	const ObjectHypothesisTest &hypothesis_test = hypothesis_tests[test_idx];
+	ObjectHypothesisTestResult &test_result = test_results[test_idx];
+	FeedbackDataForcesGenerator &data_forces_generator = test_result.data_forces_generator_;
+	btTransform &object_pose = test_result.object_pose_;
+
+	// the stages that only rank the hypotheses may use coarser collision shapes, set before the restore
+	// so the restored contacts are created for the shapes of the stage
+	std::size_t number_of_passes = child_pose_map.empty() ? std::size_t(CHILD_OBJECTS_PASS) : 
+		std::size_t(NUMBER_OF_TEST_PASSES);
+	bool ranking_stage = hypothesis_test.last_pass_ < number_of_passes;
+	// the previous test of a worker is only deterministic if there is a single worker
+	bool warm_start_test = this->contact_warm_starting_ && this->physics_engine_pool_.getNumberOfWorkers() <= 1;
+	physics_engine.setCollisionDetailLevel(ranking_stage ? this->early_ranking_collision_detail_ : 
+		int(COLLISION_DETAIL_FULL));
+
+	if (hypothesis_test.first_pass_ == PLACED_HYPOTHESIS_PASS)
+	{
+		// every test gets its own data forces generator, since the generator caches results while simulating
+		data_forces_generator = beams[hypothesis_test.beam_idx_].data_forces_generator_;
+		object_pose = hypothesis_test.object_pose_hypothesis_;
+		physics_engine.setFeedbackDataForcesGenerator(&data_forces_generator);
+		physics_engine.restoreWorldCheckpoint(settled_worlds[hypothesis_test.beam_idx_]);
+		// a nearby pose of the same object has similar contact impulses
+		if (warm_start_test) physics_engine.warmStartFromPreviousTest(hypothesis_test.object_label_);
+	}
+	else
+	{
+		// continue from the end of the previous simulation stage of this test
+		physics_engine.setFeedbackDataForcesGenerator(&data_forces_generator);
+		physics_engine.restoreWorldCheckpoint(test_result.stage_checkpoint_);
+	}
+	std::set<std::string> frozen_objects = this->freezeObjectsOutsideRegion(physics_engine, 
+		test_scope.influence_region_, hypothesis_test.object_label_);
+
+	for (std::size_t pass = hypothesis_test.first_pass_; pass < hypothesis_test.last_pass_; ++pass)
+	{
+		if (pass == SETTLED_HYPOTHESIS_PASS)
+		{
+			test_result.number_of_ticks_ += this->settleSimulation(physics_engine, .15 * GRAVITY_SCALE_COMPENSATION, 
+				GRAVITY_SCALE_COMPENSATION/120.);
+			test_result.number_of_ticks_ += this->settleSimulation(physics_engine, .1 * GRAVITY_SCALE_COMPENSATION, 
+				GRAVITY_SCALE_COMPENSATION/120.,false);
+		}
+		else if (pass == CHILD_OBJECTS_PASS)
+		{
+			// check object probability after the object stable and the childs get added back together
+			physics_engine.addExistingRigidBodyBackFromMap(child_pose_map);
+			test_result.number_of_ticks_ += this->settleSimulation(physics_engine, .15/GRAVITY_SCALE_COMPENSATION, 
+				GRAVITY_SCALE_COMPENSATION/120.);
+		}
+
+		std::stringstream evaluation_log;
+		test_result.object_probabilities_.push_back(this->evaluateSceneOnObjectHypothesis(physics_engine, 
+			data_forces_generator, test_result, hypothesis_test.object_label_, object_pose, 
+			hypothesis_test.object_action_, pass == PLACED_HYPOTHESIS_PASS, 
+			test_scope.outside_object_probabilities_[hypothesis_test.beam_idx_], frozen_objects, evaluation_log));
+		test_result.evaluation_log_.push_back(evaluation_log.str());
+
+		// get updated object pose from the scene simulation
+		const vertex_t updated_vertex = getContentOfConstantMap(hypothesis_test.object_label_, test_result.vertex_map_);
+		object_pose = test_result.scene_support_graph_[updated_vertex].object_pose_;
+	}
+
+	// the checkpoints must hold the original mass of the objects
+	this->unfreezeObjects(physics_engine, frozen_objects);
+
+	// keep the world if the test may continue in the next simulation stage
+	if (ranking_stage)
+	{
+		test_result.stage_checkpoint_ = physics_engine.captureWorldCheckpoint(true);
+	}
+	if (warm_start_test) physics_engine.saveTestContacts(hypothesis_test.object_label_);
+	physics_engine.setFeedbackDataForcesGenerator(NULL);
+	physics_engine.setCollisionDetailLevel(COLLISION_DETAIL_FULL);
+}
+
+std::set<std::string> SceneHypothesisAssessor::freezeObjectsOutsideRegion(PhysicsEngine &physics_engine, 
+	const std::set<std::string> &influence_region, const std::string &object_label) const
+{
+	std::set<std::string> frozen_objects;
+	// an empty region means the tested object is not in the scene graph yet, so nothing is known to be unaffected
+	if (influence_region.empty()) return frozen_objects;
+
+	std::vector<std::string> object_ids = physics_engine.getAllActiveObjectIds();
+	for (std::vector<std::string>::const_iterator it = object_ids.begin(); it != object_ids.end(); ++it)
+	{
+		if (*it == object_label || influence_region.find(*it) != influence_region.end()) continue;
+		physics_engine.makeObjectStatic(*it, true);
+		frozen_objects.insert(*it);
+	}
+	return frozen_objects;
+}
+
+void SceneHypothesisAssessor::unfreezeObjects(PhysicsEngine &physics_engine, 
+	const std::set<std::string> &frozen_objects) const
+{
+	for (std::set<std::string>::const_iterator it = frozen_objects.begin(); it != frozen_objects.end(); ++it)
+	{
+		physics_engine.makeObjectStatic(*it, false);
+	}
+}
+
+void SceneHypothesisAssessor::evaluateSceneBeam(PhysicsEngine &physics_engine, const std::size_t &beam_idx,
+	const std::vector<SceneBeam> &beams, const std::map<std::string, int> &object_action_map,
+	std::vector<ObjectHypothesisTestResult> &beam_results) const
+{
+	const SceneBeam &beam = beams[beam_idx];
+	ObjectHypothesisTestResult &beam_result = beam_results[beam_idx];
+
+	FeedbackDataForcesGenerator data_forces_generator = beam.data_forces_generator_;
+	physics_engine.setFeedbackDataForcesGenerator(&data_forces_generator);
+	physics_engine.resetWorldForTest(beam.best_test_pose_map_);
+
+	// same settling as the final scene of the best beam
+	beam_result.number_of_ticks_ += this->settleSimulation(physics_engine, 0.15 * GRAVITY_SCALE_COMPENSATION, 
+		GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER));
+	beam_result.number_of_ticks_ += this->settleSimulation(physics_engine, 0.5/GRAVITY_SCALE_COMPENSATION, 
+		GRAVITY_SCALE_COMPENSATION/120.,false);
+	beam_result.scene_support_graph_ = physics_engine.getUpdatedSceneGraph(beam_result.vertex_map_);
+
+	std::stringstream evaluation_log;
+	std::vector<double> object_probabilities;
+	for (std::map<std::string, vertex_t>::const_iterator it = beam_result.vertex_map_.begin();
+		it != beam_result.vertex_map_.end(); ++it)
+	{
+		if (it->first == "background") continue;
+		// only check probability for object that are exist in the dictionary
+		if (object_label_class_map.find(it->first) == object_label_class_map.end()) continue;
+		evaluation_log << it->first << " ";
+		object_probabilities.push_back(this->evaluateObjectProbability(beam_result.scene_support_graph_,
+			beam_result.vertex_map_, data_forces_generator, physics_engine.getGravityDirection(), it->first,
+			getContentOfConstantMap(it->first, object_label_class_map), 
+			getContentOfConstantMap(it->first, object_action_map), true, evaluation_log));
+	}
+	beam_result.object_probabilities_.push_back(object_probabilities);
+	beam_result.evaluation_log_.push_back(evaluation_log.str());
+	physics_engine.setFeedbackDataForcesGenerator(NULL);
+}
+
+double SceneHypothesisAssessor::getSymmetricRotationDistance(const btQuaternion &lhs, const btQuaternion &rhs,
+	const std::string &model_name, const std::map<std::string, ObjectSymmetry> &object_symmetry_map)
+{
+	if (!keyExistInConstantMap(model_name, object_symmetry_map)) return lhs.angleShortestPath(rhs);
+
+	ObjectSymmetry object_symmetry = getContentOfConstantMap(model_name, object_symmetry_map);
+	// a rotation step of 0 means the object is not symmetric around that axis
+	if (object_symmetry.roll <= 0) object_symmetry.roll = 2*pi;
+	if (object_symmetry.pitch <= 0) object_symmetry.pitch = 2*pi;
+	if (object_symmetry.yaw <= 0) object_symmetry.yaw = 2*pi;
+
+	// find the symmetric equivalent of the rotation change that is closest to identity
+	Eigen::Quaternion<float> rotation_change = convertBulletToEigenQuaternion<float>(lhs).inverse() * 
+		convertBulletToEigenQuaternion<float>(rhs);
+	rotation_change = normalizeModelOrientation(rotation_change, object_symmetry);
+	return rotation_change.angularDistance(Eigen::Quaternion<float>::Identity());
+}
+
+void SceneHypothesisAssessor::mergeDuplicatePoses(const std::vector<btTransform> &poses, 
+	const std::vector<double> &data_confidences, const std::string &model_name, 
+	const std::map<std::string, ObjectSymmetry> &object_symmetry_map, const double &max_translation, 
+	const double &max_rotation, std::vector<btTransform> &merged_poses, std::vector<double> &merged_confidences)
+{
+	merged_poses.clear();
+	merged_confidences.clear();
+	// the poses are compared with the first member of the cluster, so the clusters do not drift
+	std::vector<btTransform> anchor_poses;
+	for (std::size_t pose_idx = 0; pose_idx < poses.size(); ++pose_idx)
+	{
+		const btTransform &pose = poses[pose_idx];
+		const double &data_confidence = data_confidences[pose_idx];
+		std::size_t cluster_idx = 0;
+		for (; cluster_idx < anchor_poses.size(); ++cluster_idx)
+		{
+			const btTransform &cluster_pose = anchor_poses[cluster_idx];
+			btScalar translation_distance = pose.getOrigin().distance(cluster_pose.getOrigin())/SCALING;
+			if (translation_distance > max_translation) continue;
+			if (getSymmetricRotationDistance(cluster_pose.getRotation(), pose.getRotation(), 
+				model_name, object_symmetry_map) <= max_rotation) break;
+		}
+
+		if (cluster_idx == anchor_poses.size())
+		{
+			anchor_poses.push_back(pose);
+			merged_poses.push_back(pose);
+			merged_confidences.push_back(data_confidence);
+		}
+		else if (data_confidence > merged_confidences[cluster_idx])
+		{
+			merged_poses[cluster_idx] = pose;
+			merged_confidences[cluster_idx] = data_confidence;
+		}
+	}
+}
+
+void SceneHypothesisAssessor::limitObjectHypotheses(std::map<std::string, AdditionalHypotheses> &object_hypotheses) const
+{
+	for (std::map<std::string, AdditionalHypotheses>::iterator it = object_hypotheses.begin(); 
+		it != object_hypotheses.end(); ++it)
+	{
+		AdditionalHypotheses &obj_hypotheses = it->second;
+		if (obj_hypotheses.poses_.empty()) continue;
+		int hypothesis_limit = obj_hypotheses.object_action_ == STATIC_OBJECT ? 
+			this->static_object_hypothesis_limit_ : this->object_hypothesis_limit_;
+		const double best_confidence = obj_hypotheses.data_confidences_[0];
+		std::cerr << "Best hypothesis confidence: " << best_confidence << std::endl;
+
+		std::vector<btTransform> selected_poses;
+		std::vector<double> selected_confidences;
+		int num_tested_hypotheses = 0;
+		for (std::size_t hypothesis_idx = 0; hypothesis_idx < obj_hypotheses.poses_.size(); ++hypothesis_idx)
+		{
+			if (hypothesis_limit > 0 && num_tested_hypotheses > hypothesis_limit) break;
+
+			const double &data_confidence = obj_hypotheses.data_confidences_[hypothesis_idx];
+			if (this->min_hypothesis_confidence_ratio_ > 0 && 
+				data_confidence < this->min_hypothesis_confidence_ratio_ * best_confidence)
+			{
+				std::cerr << "Skipped " << it->first << " hypothesis #" << hypothesis_idx + 1 
+					<< " with confidence: " << data_confidence << std::endl;
+				continue;
+			}
+			num_tested_hypotheses++;
+			selected_poses.push_back(obj_hypotheses.poses_[hypothesis_idx]);
+			selected_confidences.push_back(data_confidence);
+		}
+		obj_hypotheses.poses_ = selected_poses;
+		obj_hypotheses.data_confidences_ = selected_confidences;
+	}
+}
+
+void SceneHypothesisAssessor::deduplicateObjectHypotheses(std::map<std::string, AdditionalHypotheses> &object_hypotheses)
+{
+	for (std::map<std::string, AdditionalHypotheses>::iterator it = object_hypotheses.begin(); 
+		it != object_hypotheses.end(); ++it)
+	{
+		AdditionalHypotheses &obj_hypotheses = it->second;
+		const std::string &model_name = obj_hypotheses.model_name_;
+
+		std::vector<double> data_confidences;
+		for (std::vector<btTransform>::const_iterator pose_it = obj_hypotheses.poses_.begin(); 
+			pose_it != obj_hypotheses.poses_.end(); ++pose_it)
+		{
+			data_confidences.push_back(this->data_forces_generator_.getIcpConfidenceResult(model_name, *pose_it));
+		}
+
+		std::vector<btTransform> cluster_poses;
+		std::vector<double> cluster_confidences;
+		mergeDuplicatePoses(obj_hypotheses.poses_, data_confidences, model_name, this->object_symmetry_map_,
+			this->max_duplicate_hypothesis_translation_, this->max_duplicate_hypothesis_rotation_,
+			cluster_poses, cluster_confidences);
+
+		if (cluster_poses.size() < obj_hypotheses.poses_.size())
+		{
+			std::cerr << "Merged " << obj_hypotheses.poses_.size() << " hypotheses of " << it->first 
+				<< " into " << cluster_poses.size() << " unique poses.\n";
+		}
+		obj_hypotheses.poses_ = cluster_poses;
+		obj_hypotheses.data_confidences_ = cluster_confidences;
+	}
+}
+
+map_string_transform SceneHypothesisAssessor::getComponentPoseMap(const map_string_transform &object_pose_map, 
+	const std::string &object_label, const std::map<std::string, std::size_t> &object_component_map,
+	const std::set<std::string> &merged_objects) const
+{
+	if (!keyExistInConstantMap(object_label, object_component_map)) return object_pose_map;
+
+	// the hypotheses of the object may reach into other components, which are then simulated together
+	std::set<std::size_t> object_components;
+	object_components.insert(getContentOfConstantMap(object_label, object_component_map));
+	for (std::set<std::string>::const_iterator it = merged_objects.begin(); it != merged_objects.end(); ++it)
+	{
+		if (keyExistInConstantMap(*it, object_component_map)) 
+			object_components.insert(getContentOfConstantMap(*it, object_component_map));
+	}
+
+	map_string_transform result;
+	for (map_string_transform::const_iterator it = object_pose_map.begin(); it != object_pose_map.end(); ++it)
+	{
+		// keep the objects that are unknown to the component map, since they may interact with the object
+		if (keyExistInConstantMap(it->first, object_component_map) && 
+			object_components.find(getContentOfConstantMap(it->first, object_component_map)) == 
+				object_components.end()) continue;
+		result[it->first] = it->second;
+	}
+	return result;
+}
+
+void SceneHypothesisAssessor::updateMissingCachedIcpResult(FeedbackDataForcesGenerator &data_forces_generator, 
+	const map_string_transform &object_pose_map) const
+{
+	for (map_string_transform::const_iterator it = object_pose_map.begin(); it != object_pose_map.end(); ++it)
+	{
+		if (!keyExistInConstantMap(it->first, object_label_class_map)) continue;
+		data_forces_generator.updateMissingCachedIcpResult(it->second, it->first, 
+			getContentOfConstantMap(it->first, object_label_class_map));
+	}
+}
+
 void SceneHypothesisAssessor::evaluateAllObjectHypothesisProbability()
 {
+	// the universal time does not jump on daylight saving or time zone changes
+	this->evaluation_start_time_ = boost::posix_time::microsec_clock::universal_time();
 	// Set the best test pose map based on the best data
 	std::map<std::string, bool> object_background_support_status;
 
@@ -564,6 +1157,21 @@ void SceneHypothesisAssessor::evaluateAllObjectHypothesisProbability()
 	hypotheses_to_test = sequential_scene_hypothesis_.generateObjectHypothesesWithPreviousKnowledge(object_test_pose_map_by_dist,
 		object_childs_map,
 		this->object_hypotheses_map_);
+	// near identical and symmetric equivalent poses only need to be simulated once
+	this->deduplicateObjectHypotheses(hypotheses_to_test);
+	this->limitObjectHypotheses(hypotheses_to_test);
+
+	// the objects that are expected to stay at their pose keep the contact impulses of the previous frame
+	this->frame_warm_start_objects_.clear();
+	if (this->contact_warm_starting_ && this->previous_frame_contacts_.have_contact_manifolds_)
+	{
+		for (std::map<std::string, AdditionalHypotheses>::const_iterator it = hypotheses_to_test.begin(); 
+			it != hypotheses_to_test.end(); ++it)
+		{
+			if (it->second.object_action_ == STATIC_OBJECT || it->second.object_action_ == SUPPORT_RETAINED_OBJECT)
+				this->frame_warm_start_objects_.insert(it->first);
+		}
+	}
 
 	if (!include_prev_observation_)
 	{
@@ -592,7 +1200,7 @@ void SceneHypothesisAssessor::evaluateAllObjectHypothesisProbability()
 			}
 		}
 
-		this->physics_engine_->stepSimulationWithoutEvaluation(0.15 * GRAVITY_SCALE_COMPENSATION, 
+		this->settleSimulation(*this->physics_engine_, 0.15 * GRAVITY_SCALE_COMPENSATION, 
 			GRAVITY_SCALE_COMPENSATION/120.);
 		this->getUpdatedSceneSupportGraph();
 
@@ -606,16 +1214,16 @@ void SceneHypothesisAssessor::evaluateAllObjectHypothesisProbability()
 			{
 				this->physics_engine_->addExistingRigidBodyBackFromMap(it->first,original_pose_to_test[it->first]);
 			}
-			this->physics_engine_->stepSimulationWithoutEvaluation(0.15 * GRAVITY_SCALE_COMPENSATION, 
+			this->settleSimulation(*this->physics_engine_, 0.15 * GRAVITY_SCALE_COMPENSATION, 
 				GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER));
-			this->physics_engine_->stepSimulationWithoutEvaluation(0.1 * GRAVITY_SCALE_COMPENSATION, 
+			this->settleSimulation(*this->physics_engine_, 0.1 * GRAVITY_SCALE_COMPENSATION, 
 				GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER),false);
 		}
 
-		this->physics_engine_->stepSimulationWithoutEvaluation(0.15 * GRAVITY_SCALE_COMPENSATION, 
+		this->settleSimulation(*this->physics_engine_, 0.15 * GRAVITY_SCALE_COMPENSATION, 
 			GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER));
 
-		this->physics_engine_->stepSimulationWithoutEvaluation(0.5 * GRAVITY_SCALE_COMPENSATION, 
+		this->settleSimulation(*this->physics_engine_, 0.5 * GRAVITY_SCALE_COMPENSATION, 
 			GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER),false);
 
 		this->physics_engine_->setSimulationMode(RESET_VELOCITY_ON_EACH_FRAME,GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER),
@@ -658,19 +1266,80 @@ void SceneHypothesisAssessor::evaluateAllObjectHypothesisProbability()
 	this->physics_engine_->setSimulationMode(RESET_VELOCITY_ON_EACH_FRAME,GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER),
 		GRAVITY_SCALE_COMPENSATION*3);
 
+	// the hypotheses are tested on the workers, which have the same objects and setting as the main physics engine
+	this->physics_engine_pool_.synchronizeWorkers(*this->physics_engine_);
+
 	std::map<std::string, map_string_transform> child_of_vertices;
 	
 	OneFrameSceneHypotheses scene_hypotheses_list;
-	std::map<std::string, int> scene_object_hypothesis_id;
 	std::map<std::string, int> object_action_map;
+	std::map<std::string, ObjectHypothesesEvaluationReport> hypotheses_evaluation_report;
+	std::map<std::string, bool> object_fully_evaluated;
+
+	// the objects are evaluated one by one, every beam keeps a partial scene configuration of the evaluated objects.
+	// With a beam width of 1, only the best pose of every evaluated object is kept.
+	std::vector<SceneBeam> beams(1);
+	beams[0].best_test_pose_map_ = this->physics_engine_->getBestTestPoseMap();
+	beams[0].object_background_support_status_ = object_background_support_status;
+	beams[0].data_forces_generator_ = this->data_forces_generator_;
+
+	// objects in different components of the support graph from the data do not interact with each other
+	std::map<std::string, std::size_t> object_component_map;
+	if (this->separate_support_components_)
+	{
+		object_component_map = getSceneGraphComponents(this->scene_support_graph_, this->vertex_map_, 0.01 * SCALING);
+	}
+
+	// objects that are left out of a test keep the probability of their data pose until they are evaluated
+	std::map<std::string, double> data_pose_object_probabilities;
+	if (this->separate_support_components_)
+	{
+		for (std::map<std::string, vertex_t>::const_iterator it = this->vertex_map_.begin(); 
+			it != this->vertex_map_.end(); ++it)
+		{
+			if (it->first == "background" || !keyExistInConstantMap(it->first, object_label_class_map)) continue;
+			int object_action = keyExistInConstantMap(it->first, hypotheses_to_test) ? 
+				hypotheses_to_test[it->first].object_action_ : static_cast<int>(STATIC_OBJECT);
+			data_pose_object_probabilities[it->first] = this->evaluateObjectProbability(it->first, 
+				getContentOfConstantMap(it->first, object_label_class_map), object_action, false);
+		}
+	}
+
+	// the simulation budget is shared by the objects according to their uncertainty
+	std::map<std::string, double> object_budget_weight;
+	double remaining_budget_weight = 0;
+	unsigned int spent_simulation_ticks = 0;
+	if (this->hypothesis_simulation_budget_ > 0)
+	{
+		for (std::size_t dist_idx = 0; dist_idx < object_test_pose_map_by_dist.size(); ++dist_idx)
+		{
+			for (map_string_transform::const_iterator it = object_test_pose_map_by_dist[dist_idx].begin(); 
+				it != object_test_pose_map_by_dist[dist_idx].end(); ++it)
+			{
+				if (!keyExistInConstantMap(it->first, hypotheses_to_test)) continue;
+				double weight = this->getObjectSimulationBudgetWeight(hypotheses_to_test[it->first], dist_idx);
+				object_budget_weight[it->first] = weight;
+				remaining_budget_weight += weight;
+			}
+		}
+	}
 
 	for (std::size_t dist_idx = 0; dist_idx < object_test_pose_map_by_dist.size(); ++dist_idx)
 	{
 		this->physics_engine_->addExistingRigidBodyBackFromMap(object_test_pose_map_by_dist[dist_idx]);
-		for (std::map<std::string, btTransform>::const_iterator it = object_test_pose_map_by_dist[dist_idx].begin(); 
-			it != object_test_pose_map_by_dist[dist_idx].end(); ++it)
+		for (std::vector<SceneBeam>::iterator beam_it = beams.begin(); beam_it != beams.end(); ++beam_it)
 		{
-			scene_object_hypothesis_id[it->first] = 0;
+			for (std::map<std::string, btTransform>::const_iterator it = object_test_pose_map_by_dist[dist_idx].begin(); 
+				it != object_test_pose_map_by_dist[dist_idx].end(); ++it)
+			{
+				beam_it->best_test_pose_map_[it->first] = it->second;
+				beam_it->scene_object_hypothesis_id_[it->first] = 0;
+				if (!keyExistInConstantMap(it->first, beam_it->object_probabilities_) && 
+					keyExistInConstantMap(it->first, data_pose_object_probabilities))
+				{
+					beam_it->object_probabilities_[it->first] = data_pose_object_probabilities[it->first];
+				}
+			}
 		}
 		// Force best scene to update when the distance increased.
 		// bool force_update_by_increased_distance = true;
@@ -680,14 +1349,22 @@ void SceneHypothesisAssessor::evaluateAllObjectHypothesisProbability()
 		for (std::map<std::string, btTransform>::iterator it = object_test_pose_map_by_dist[dist_idx].begin();
 			it != object_test_pose_map_by_dist[dist_idx].end(); ++it)
 		{
-			double best_object_probability_effect = 0;
-
 			const std::string &object_pose_label = it->first;
 			if (!keyExistInConstantMap(object_pose_label, hypotheses_to_test))
 			{
+				// there is nothing to evaluate for this object
+				object_fully_evaluated[object_pose_label] = true;
 				std::cerr << "Skipped " << object_pose_label << " because its hypothesis does not exist\n";
 				continue;
 			}
+			if (this->checkEvaluationDeadlineReached())
+			{
+				// the object stays at its pose from the best data
+				object_fully_evaluated[object_pose_label] = false;
+				std::cerr << "Skipped " << object_pose_label << " because the evaluation deadline has been reached\n";
+				continue;
+			}
+			bool evaluation_interrupted = false;
 			
 			const AdditionalHypotheses &obj_hypotheses = hypotheses_to_test[object_pose_label];
 			const std::string &object_model_name = obj_hypotheses.model_name_;
@@ -695,139 +1372,489 @@ void SceneHypothesisAssessor::evaluateAllObjectHypothesisProbability()
 
 			object_action_map[object_pose_label] = obj_hypotheses.object_action_;
 
-			bool &current_background_support_status = object_background_support_status[it->first];
-			bool updated_background_support_status = current_background_support_status;
+			std::size_t number_of_object_hypotheses = object_pose_hypotheses.size();
+			ObjectHypothesesEvaluationReport &evaluation_report = hypotheses_evaluation_report[object_pose_label];
+
+			// the object gets its share of the remaining budget. The first wave of tests always runs, with an
+			// exhausted budget the tests stop right after it.
+			bool object_budget_limited = this->hypothesis_simulation_budget_ > 0;
+			unsigned int object_simulation_budget = 0;
+			if (object_budget_limited)
+			{
+				const double &weight = object_budget_weight[object_pose_label];
+				unsigned int remaining_budget = spent_simulation_ticks < this->hypothesis_simulation_budget_ ? 
+					this->hypothesis_simulation_budget_ - spent_simulation_ticks : 0;
+				object_simulation_budget = remaining_budget_weight > 0 ? 
+					remaining_budget * weight / remaining_budget_weight : remaining_budget;
+				remaining_budget_weight -= weight;
+				evaluation_report.allocated_ticks_ = object_simulation_budget;
+				if (object_simulation_budget == 0)
+				{
+					std::cerr << "Simulation budget exhausted, only the first tests of " << object_pose_label << " run.\n";
+				}
+			}
+
+			// every hypothesis is tested on every beam
+			std::vector<ObjectHypothesisTest> candidate_tests;
+			for (std::size_t beam_idx = 0; beam_idx < beams.size(); ++beam_idx)
+			{
+				for (std::size_t hypothesis_idx = 0; hypothesis_idx < number_of_object_hypotheses; ++hypothesis_idx)
+				{
+					ObjectHypothesisTest hypothesis_test;
+					hypothesis_test.object_label_ = object_pose_label;
+					hypothesis_test.object_model_name_ = object_model_name;
+					hypothesis_test.object_action_ = obj_hypotheses.object_action_;
+					hypothesis_test.hypothesis_idx_ = hypothesis_idx;
+					hypothesis_test.object_pose_hypothesis_ = object_pose_hypotheses[hypothesis_idx];
+					hypothesis_test.beam_idx_ = beam_idx;
+					candidate_tests.push_back(hypothesis_test);
+				}
+			}
 
-			// bool update_from_this_object = false;
-			ObjectParameter best_object_pose = object_pose_hypotheses[0];
+			ObjectTestScope test_scope;
+			test_scope.child_pose_map_ = object_childs_map[object_pose_label];
+			const map_string_transform &child_pose_map = test_scope.child_pose_map_;
 
-			std::map<std::string, ObjectParameter> best_object_pose_from_graph;
+			// compute the missing cached icp results once here, instead of once in every test
+			for (std::vector<SceneBeam>::iterator beam_it = beams.begin(); beam_it != beams.end(); ++beam_it)
+			{
+				this->updateMissingCachedIcpResult(beam_it->data_forces_generator_, beam_it->best_test_pose_map_);
+				this->updateMissingCachedIcpResult(beam_it->data_forces_generator_, child_pose_map);
+			}
 
-			std::size_t hypothesis_idx = 0, num_tested_hypotheses = 0;
-			std::size_t number_of_object_hypotheses = object_pose_hypotheses.size();
-			double best_ransac_confidence;
-			int best_hypothesis_id = 0;
+			// objects that any hypothesis of this object reaches can interact with it during the tests
+			std::set<std::string> hypotheses_overlapping_objects;
+			if (this->separate_support_components_ || this->freeze_outside_influence_region_)
+			{
+				hypotheses_overlapping_objects = getObjectsOverlappingPoses(this->scene_support_graph_, 
+					this->vertex_map_, object_pose_label, object_pose_hypotheses, 0.01 * SCALING);
+			}
+
+			// the tests only simulate the objects that are in the same component as this object or its hypotheses
+			std::vector<map_string_transform> beam_test_pose_maps;
+			for (std::vector<SceneBeam>::const_iterator beam_it = beams.begin(); beam_it != beams.end(); ++beam_it)
+			{
+				beam_test_pose_maps.push_back(this->getComponentPoseMap(beam_it->best_test_pose_map_, 
+					object_pose_label, object_component_map, hypotheses_overlapping_objects));
+			}
 
-			for (std::vector<ObjectParameter>::const_iterator it2 = object_pose_hypotheses.begin();
-				it2 != object_pose_hypotheses.end(); ++it2, ++hypothesis_idx)
+			// the objects outside the influence region of this object are static during its tests
+			if (this->freeze_outside_influence_region_)
 			{
-				scene_object_hypothesis_id[object_pose_label] = hypothesis_idx;
-				ObjectParameter object_pose = *it2;
-				double ransac_confidence = this->data_forces_generator_.getIcpConfidenceResult(object_model_name, object_pose);
-				if (it2 == object_pose_hypotheses.begin())
+				test_scope.influence_region_ = getObjectInfluenceRegion(this->scene_support_graph_, this->vertex_map_, 
+					object_pose_label, 0.01 * SCALING);
+				// the hypotheses can push the objects they overlap, which move their own neighbors
+				if (!test_scope.influence_region_.empty())
 				{
-					best_ransac_confidence = ransac_confidence;
-					std::cerr << "Best hypothesis confidence: " << best_ransac_confidence << std::endl;
+					for (std::set<std::string>::const_iterator region_it = hypotheses_overlapping_objects.begin(); 
+						region_it != hypotheses_overlapping_objects.end(); ++region_it)
+					{
+						std::set<std::string> overlapped_region = getObjectInfluenceRegion(this->scene_support_graph_, 
+							this->vertex_map_, *region_it, 0.01 * SCALING);
+						test_scope.influence_region_.insert(overlapped_region.begin(), overlapped_region.end());
+					}
 				}
+			}
 
-				// limit observation to 5 best previous hypothesis for static object
-				if (obj_hypotheses.object_action_ == STATIC_OBJECT && num_tested_hypotheses > 5) break;
-				else if (num_tested_hypotheses > 15) break;
-
-				std::cerr << "Evaluating object: " << object_pose_label << " hypothesis #" 
-					<< hypothesis_idx + 1 << "/" << number_of_object_hypotheses << std::endl;
-				if (ransac_confidence < 0.5 * best_ransac_confidence)
+			// only the objects that the tests do not evaluate keep their last probability, the others are recomputed.
+			// The left out objects are never simulated, so their probability bounds the scene probability on the beam.
+			std::vector<double> beam_upper_bounds;
+			for (std::size_t beam_idx = 0; beam_idx < beams.size(); ++beam_idx)
+			{
+				const SceneBeam &beam = beams[beam_idx];
+				std::map<std::string, double> outside_object_probabilities, left_out_object_probabilities;
+				for (map_string_transform::const_iterator pose_it = beam.best_test_pose_map_.begin(); 
+					pose_it != beam.best_test_pose_map_.end(); ++pose_it)
 				{
-					std::cerr << "Skipped hypothesis with confidence: " << ransac_confidence << std::endl;
-					continue;
+					if (pose_it->first == object_pose_label || 
+						!keyExistInConstantMap(pose_it->first, beam.object_probabilities_)) continue;
+					bool left_out = !keyExistInConstantMap(pose_it->first, beam_test_pose_maps[beam_idx]);
+					bool may_be_frozen = !test_scope.influence_region_.empty() && 
+						test_scope.influence_region_.find(pose_it->first) == test_scope.influence_region_.end();
+					if (!left_out && !may_be_frozen) continue;
+					outside_object_probabilities[pose_it->first] = 
+						getContentOfConstantMap(pose_it->first, beam.object_probabilities_);
+					if (left_out) left_out_object_probabilities[pose_it->first] = outside_object_probabilities[pose_it->first];
 				}
-				num_tested_hypotheses++;
+				test_scope.outside_object_probabilities_.push_back(outside_object_probabilities);
+				beam_upper_bounds.push_back(getSceneProbabilityUpperBound(left_out_object_probabilities));
+			}
 
-				// std::cerr << "-------------------------------------------------------------\n";
-				double scene_hypothesis_probability;
-				std::map<std::string, ObjectParameter> tmp_object_pose_config;
-				for (int i = 0; i < 2; i++)
+			// settle the objects below this object once per beam, then every test starts from the settled checkpoint
+			std::vector<WorldCheckpoint> settled_worlds(beams.size());
+			std::vector<unsigned int> settle_ticks(beams.size(), 0);
+			if (number_of_object_hypotheses > 0) this->physics_engine_pool_.runJobs(beams.size(), 
+				boost::bind(&SceneHypothesisAssessor::settleWorldForTest, this,
+					_1, _2, boost::cref(beams), boost::cref(beam_test_pose_maps), boost::ref(settled_worlds),
+					boost::ref(settle_ticks)));
+			// the settling is part of the simulation spent on this object
+			unsigned int settle_simulation_ticks = 0;
+			for (std::vector<unsigned int>::const_iterator tick_it = settle_ticks.begin(); tick_it != settle_ticks.end(); ++tick_it)
+				settle_simulation_ticks += *tick_it;
+			evaluation_report.simulated_ticks_ += settle_simulation_ticks;
+
+			// background support status and best scene probability of this object on every beam
+			std::vector<bool> current_background_support_status(beams.size()), updated_background_support_status(beams.size());
+			std::vector<double> best_object_probability_effect(beams.size(), 0.);
+			std::vector<bool> beam_has_candidate(beams.size(), false);
+			for (std::size_t beam_idx = 0; beam_idx < beams.size(); ++beam_idx)
+			{
+				current_background_support_status[beam_idx] = beams[beam_idx].object_background_support_status_[object_pose_label];
+				updated_background_support_status[beam_idx] = current_background_support_status[beam_idx];
+			}
+			std::vector<SceneBeamCandidate> beam_candidates;
+
+			// With successive halving every test pass is a simulation stage, and only the best part of the hypotheses
+			// continues to the next stage. Otherwise all passes are simulated in one stage.
+			std::size_t number_of_passes = child_pose_map.empty() ? std::size_t(CHILD_OBJECTS_PASS) : 
+				std::size_t(NUMBER_OF_TEST_PASSES);
+			std::vector<double> promotion_fractions = this->getHypothesisPromotionFractions(obj_hypotheses.object_action_);
+			bool use_successive_halving = false;
+			for (std::size_t i = 0; i + 1 < number_of_passes && i < promotion_fractions.size(); ++i)
+			{
+				if (promotion_fractions[i] < 1) use_successive_halving = true;
+			}
+			std::vector<std::size_t> stage_last_pass;
+			if (use_successive_halving)
+			{
+				for (std::size_t pass = 1; pass <= number_of_passes; ++pass) stage_last_pass.push_back(pass);
+			}
+			else stage_last_pass.push_back(number_of_passes);
+
+			std::vector<ObjectHypothesisTestResult> test_results(candidate_tests.size());
+			std::vector<std::size_t> active_tests;
+			for (std::size_t test_idx = 0; test_idx < candidate_tests.size(); ++test_idx) active_tests.push_back(test_idx);
+			std::size_t number_of_eliminated_tests = 0;
+
+			for (std::size_t stage = 0; stage + 1 < stage_last_pass.size(); ++stage)
+			{
+				for (std::vector<std::size_t>::const_iterator test_it = active_tests.begin(); test_it != active_tests.end(); ++test_it)
 				{
-					this->physics_engine_->stepSimulationWithoutEvaluation(.15 * GRAVITY_SCALE_COMPENSATION, 
-						GRAVITY_SCALE_COMPENSATION/120.);
-					this->physics_engine_->stepSimulationWithoutEvaluation(.1 * GRAVITY_SCALE_COMPENSATION, 
-						GRAVITY_SCALE_COMPENSATION/120.,false);
+					candidate_tests[*test_it].first_pass_ = stage > 0 ? stage_last_pass[stage - 1] : 0;
+					candidate_tests[*test_it].last_pass_ = stage_last_pass[stage];
+				}
+				unsigned int ticks_before_stage = 0, ticks_after_stage = 0;
+				for (std::vector<std::size_t>::const_iterator test_it = active_tests.begin(); test_it != active_tests.end(); ++test_it)
+					ticks_before_stage += test_results[*test_it].number_of_ticks_;
+
+				this->physics_engine_pool_.runJobs(active_tests.size(),
+					boost::bind(&SceneHypothesisAssessor::testObjectHypothesis, this, _1, _2,
+						boost::cref(active_tests), boost::cref(candidate_tests), boost::cref(beams), 
+						boost::cref(settled_worlds), boost::cref(test_scope), boost::ref(test_results)));
+
+				// rank the tests by their partial scene probability
+				std::vector<SceneBeamCandidate> stage_ranking;
+				for (std::vector<std::size_t>::const_iterator test_it = active_tests.begin(); test_it != active_tests.end(); ++test_it)
+				{
+					const ObjectHypothesisTestResult &test_result = test_results[*test_it];
+					ticks_after_stage += test_result.number_of_ticks_;
+
+					SceneBeamCandidate stage_candidate;
+					stage_candidate.test_idx_ = *test_it;
+					stage_candidate.beam_idx_ = candidate_tests[*test_it].beam_idx_;
+					stage_candidate.hypothesis_idx_ = candidate_tests[*test_it].hypothesis_idx_;
+					stage_candidate.object_pose_ = test_result.object_pose_;
+					stage_candidate.background_support_status_ = current_background_support_status[stage_candidate.beam_idx_];
+					for (std::size_t i = 0; i < test_result.object_probabilities_.size(); ++i)
+					{
+						stage_candidate.scene_probability_ = composeSceneProbability(test_result.object_probabilities_[i],
+							stage_candidate.background_support_status_);
+					}
+					stage_ranking.push_back(stage_candidate);
+				}
+				evaluation_report.estimated_saved_ticks_ += active_tests.empty() ? 0 : 
+					number_of_eliminated_tests * (ticks_after_stage - ticks_before_stage) / active_tests.size();
+				std::stable_sort(stage_ranking.begin(), stage_ranking.end(), compare_beam_candidate);
 
-					seq_mtx_.lock();
-					scene_hypothesis_probability = this->evaluateSceneOnObjectHypothesis(tmp_object_pose_config,
-						object_pose_label, object_model_name, updated_background_support_status,
-						object_pose, obj_hypotheses.object_action_, i == 0);
+				bool budget_reached = object_budget_limited && 
+					settle_simulation_ticks + getNumberOfSimulatedTicks(test_results) >= object_simulation_budget;
+				if (budget_reached || this->checkEvaluationDeadlineReached())
+				{
+					// use the partial scene probability of this stage to select the beams
+					std::cerr << "Evaluation " << (budget_reached ? "budget" : "deadline") << " reached after simulation stage " 
+						<< stage + 1 << " of " << object_pose_label << std::endl;
+					for (std::vector<SceneBeamCandidate>::const_iterator cand_it = stage_ranking.begin(); 
+						cand_it != stage_ranking.end(); ++cand_it)
+					{
+						evaluation_report.tested_hypothesis_id_.push_back(cand_it->hypothesis_idx_);
+						evaluation_report.simulated_ticks_ += test_results[cand_it->test_idx_].number_of_ticks_;
+						if (cand_it->scene_probability_ <= 0) continue;
+						beam_candidates.push_back(*cand_it);
+						beam_has_candidate[cand_it->beam_idx_] = true;
+					}
+					active_tests.clear();
+					evaluation_interrupted = true;
+					break;
+				}
 
-					// get updated object pose from the scene simulation
-					const vertex_t updated_vertex = this->vertex_map_[it->first];
-					object_pose = this->scene_support_graph_[updated_vertex].object_pose_;
+				// keep at least enough hypotheses to fill the beams
+				double promotion_fraction = stage < promotion_fractions.size() ? promotion_fractions[stage] : 1.;
+				std::size_t number_of_promoted_tests = std::ceil(promotion_fraction * stage_ranking.size());
+				number_of_promoted_tests = std::max(number_of_promoted_tests, 
+					std::min(this->scene_beam_width_, stage_ranking.size()));
+
+				std::vector<bool> promoted_test(candidate_tests.size(), false);
+				for (std::size_t i = 0; i < number_of_promoted_tests && i < stage_ranking.size(); ++i)
+					promoted_test[stage_ranking[i].test_idx_] = true;
+				for (std::vector<SceneBeamCandidate>::const_iterator cand_it = stage_ranking.begin(); 
+					cand_it != stage_ranking.end(); ++cand_it)
+				{
+					if (promoted_test[cand_it->test_idx_]) continue;
+					std::cerr << "Stopped " << object_pose_label << " hypothesis #" << cand_it->hypothesis_idx_ + 1 
+						<< " after simulation stage " << stage + 1 << " with scene probability: " 
+						<< cand_it->scene_probability_ << std::endl;
+					evaluation_report.eliminated_hypothesis_id_.push_back(cand_it->hypothesis_idx_);
+					evaluation_report.eliminated_stage_.push_back(stage);
+					evaluation_report.simulated_ticks_ += test_results[cand_it->test_idx_].number_of_ticks_;
+
+					const ObjectHypothesisTestResult &test_result = test_results[cand_it->test_idx_];
+					std::map<std::string, int> scene_object_hypothesis_id = beams[cand_it->beam_idx_].scene_object_hypothesis_id_;
+					scene_object_hypothesis_id[object_pose_label] = cand_it->hypothesis_idx_;
+					scene_hypotheses_list.push_back(SceneHypothesis(test_result.vertex_map_, test_result.scene_support_graph_,
+						cand_it->scene_probability_, scene_object_hypothesis_id));
+					++number_of_eliminated_tests;
+				}
 
-					seq_mtx_.unlock();
+				// the promoted tests stay in the hypotheses order
+				std::vector<std::size_t> promoted_tests;
+				for (std::vector<std::size_t>::const_iterator test_it = active_tests.begin(); test_it != active_tests.end(); ++test_it)
+				{
+					if (promoted_test[*test_it]) promoted_tests.push_back(*test_it);
+				}
+				active_tests.swap(promoted_tests);
+			}
 
-					std::cerr << "Scene probability = " << scene_hypothesis_probability << std::endl;
+			// the last stage tests the hypotheses in waves of one hypothesis per worker
+			for (std::vector<std::size_t>::const_iterator test_it = active_tests.begin(); test_it != active_tests.end(); ++test_it)
+			{
+				candidate_tests[*test_it].first_pass_ = stage_last_pass.size() > 1 ? stage_last_pass[stage_last_pass.size() - 2] : 0;
+				candidate_tests[*test_it].last_pass_ = stage_last_pass.back();
+			}
+			std::size_t wave_size = this->physics_engine_pool_.getNumberOfWorkers();
+			std::size_t active_idx = 0;
+			unsigned int last_stage_ticks = 0, number_of_last_stage_tests = 0;
+			while (active_idx < active_tests.size())
+			{
+				bool budget_reached = object_budget_limited && 
+					settle_simulation_ticks + getNumberOfSimulatedTicks(test_results) >= object_simulation_budget;
+				if (active_idx > 0 && (budget_reached || this->checkEvaluationDeadlineReached()))
+				{
+					std::cerr << "Evaluation " << (budget_reached ? "budget" : "deadline") << " reached after testing " 
+						<< active_idx << " of " << active_tests.size() << " hypotheses of " << object_pose_label << std::endl;
+					for (; active_idx < active_tests.size(); ++active_idx)
+					{
+						evaluation_report.skipped_hypothesis_id_.push_back(
+							candidate_tests[active_tests[active_idx]].hypothesis_idx_);
+					}
+					evaluation_interrupted = true;
+					break;
 				}
 
-				if (object_childs_map[object_pose_label].size() > 0)
+				std::vector<std::size_t> wave_tests;
+				for (; active_idx < active_tests.size() && wave_tests.size() < wave_size; ++active_idx)
 				{
-					// check object probability after the object stable and the childs get added back together
-					this->physics_engine_->addExistingRigidBodyBackFromMap(object_childs_map[object_pose_label]);
-					this->physics_engine_->stepSimulationWithoutEvaluation(.15/GRAVITY_SCALE_COMPENSATION, 
-						GRAVITY_SCALE_COMPENSATION/120.);
-
-					seq_mtx_.lock();
-					scene_hypothesis_probability = this->evaluateSceneOnObjectHypothesis(tmp_object_pose_config,
-						object_pose_label, object_model_name, updated_background_support_status,
-						object_pose, obj_hypotheses.object_action_, false);
-
-					// get updated object pose from the scene simulation
-					const vertex_t updated_vertex = this->vertex_map_[it->first];
-					object_pose = this->scene_support_graph_[updated_vertex].object_pose_;
-					seq_mtx_.unlock();
-					this->physics_engine_->removeExistingRigidBodyWithMap(object_childs_map[object_pose_label]);
-
-					std::cerr << "Scene probability = " << scene_hypothesis_probability << std::endl;	
+					const ObjectHypothesisTest &candidate_test = candidate_tests[active_tests[active_idx]];
+					const double &upper_bound = beam_upper_bounds[candidate_test.beam_idx_];
+					// The hypothesis is pruned if it can not get into the beams anymore. The candidates only grow
+					// during the tests, so a hypothesis pruned here is also pruned by the serial tests.
+					if (this->checkHypothesisPruned(upper_bound, current_background_support_status[candidate_test.beam_idx_],
+						beam_candidates))
+					{
+						std::cerr << "Pruned " << object_pose_label << " hypothesis #" << candidate_test.hypothesis_idx_ + 1 
+							<< " with scene probability upper bound: " << upper_bound << std::endl;
+						evaluation_report.pruned_hypothesis_id_.push_back(candidate_test.hypothesis_idx_);
+						evaluation_report.pruned_upper_bound_.push_back(upper_bound);
+						continue;
+					}
+					wave_tests.push_back(active_tests[active_idx]);
 				}
 
-				// update the best scene if the current scene probability is better or there is
-				// a change from not background supported to background supported on this object hypothesis
-				if ((best_object_probability_effect < scene_hypothesis_probability) ||
-					(!current_background_support_status && updated_background_support_status)
-					// || force_update_by_increased_distance
-					)
+				// ticks of the earlier simulation stages of the tests
+				std::vector<unsigned int> ticks_before_stage;
+				for (std::vector<std::size_t>::const_iterator test_it = wave_tests.begin(); test_it != wave_tests.end(); ++test_it)
+					ticks_before_stage.push_back(test_results[*test_it].number_of_ticks_);
+
+				this->physics_engine_pool_.runJobs(wave_tests.size(),
+					boost::bind(&SceneHypothesisAssessor::testObjectHypothesis, this, _1, _2,
+						boost::cref(wave_tests), boost::cref(candidate_tests), boost::cref(beams), 
+						boost::cref(settled_worlds), boost::cref(test_scope), boost::ref(test_results)));
+
+				// go through the test results in the hypotheses order, so the selected hypothesis does not
+				// depend on the number of threads used
+				for (std::vector<std::size_t>::const_iterator test_it = wave_tests.begin(); test_it != wave_tests.end(); ++test_it)
 				{
-					if (!current_background_support_status && updated_background_support_status)
+					const ObjectHypothesisTest &hypothesis_test = candidate_tests[*test_it];
+					const ObjectHypothesisTestResult &test_result = test_results[*test_it];
+					const std::size_t &beam_idx = hypothesis_test.beam_idx_;
+					// the serial tests would have pruned this hypothesis with the results of the earlier
+					// hypotheses of the wave, so its result is dropped
+					const double &upper_bound = beam_upper_bounds[beam_idx];
+					if (this->checkHypothesisPruned(upper_bound, current_background_support_status[beam_idx], beam_candidates))
 					{
-						current_background_support_status = updated_background_support_status;
+						std::cerr << "Pruned " << object_pose_label << " hypothesis #" << hypothesis_test.hypothesis_idx_ + 1 
+							<< " with scene probability upper bound: " << upper_bound << std::endl;
+						evaluation_report.pruned_hypothesis_id_.push_back(hypothesis_test.hypothesis_idx_);
+						evaluation_report.pruned_upper_bound_.push_back(upper_bound);
+						continue;
 					}
-					best_object_pose = object_pose;
-					best_object_probability_effect = scene_hypothesis_probability;
-					best_object_pose_from_graph = tmp_object_pose_config;
-					// update_from_this_object = true;
-					best_hypothesis_id = hypothesis_idx;
-					// force_update_by_increased_distance = false;
+					std::cerr << "Evaluating object: " << object_pose_label << " hypothesis #" 
+						<< hypothesis_test.hypothesis_idx_ + 1 << "/" << number_of_object_hypotheses;
+					if (beams.size() > 1) std::cerr << " on beam #" << beam_idx + 1;
+					std::cerr << std::endl;
+					evaluation_report.tested_hypothesis_id_.push_back(hypothesis_test.hypothesis_idx_);
+					evaluation_report.simulated_ticks_ += test_result.number_of_ticks_;
+					last_stage_ticks += test_result.number_of_ticks_ - ticks_before_stage[test_it - wave_tests.begin()];
+					++number_of_last_stage_tests;
+
+					// std::cerr << "-------------------------------------------------------------\n";
+					double scene_hypothesis_probability = 0;
+					bool background_support_status = updated_background_support_status[beam_idx];
+					for (std::size_t i = 0; i < test_result.object_probabilities_.size(); ++i)
+					{
+						std::cerr << test_result.evaluation_log_[i];
+						scene_hypothesis_probability = composeSceneProbability(test_result.object_probabilities_[i],
+							background_support_status);
+						std::cerr << "Scene probability = " << scene_hypothesis_probability << std::endl;
+					}
+					updated_background_support_status[beam_idx] = background_support_status;
+
+					// the hypothesis can extend the beam if the scene probability is not zero or there is
+					// a change from not background supported to background supported on this object hypothesis
+					bool background_support_changed = !current_background_support_status[beam_idx] && 
+						updated_background_support_status[beam_idx];
+					if (scene_hypothesis_probability > 0 || background_support_changed)
+					{
+						if (background_support_changed) current_background_support_status[beam_idx] = true;
+
+						SceneBeamCandidate beam_candidate;
+						beam_candidate.test_idx_ = *test_it;
+						beam_candidate.beam_idx_ = beam_idx;
+						beam_candidate.hypothesis_idx_ = hypothesis_test.hypothesis_idx_;
+						beam_candidate.object_pose_ = test_result.object_pose_;
+						beam_candidate.background_support_status_ = current_background_support_status[beam_idx];
+						beam_candidate.scene_probability_ = scene_hypothesis_probability;
+						beam_candidates.push_back(beam_candidate);
+						beam_has_candidate[beam_idx] = true;
+
+						if (best_object_probability_effect[beam_idx] < scene_hypothesis_probability || background_support_changed)
+							best_object_probability_effect[beam_idx] = scene_hypothesis_probability;
+					}
+					std::cerr << "Best scene probability: " << best_object_probability_effect[beam_idx] 
+						<< ", simulated ticks: " << test_result.number_of_ticks_ << std::endl;
+
+					std::map<std::string, int> scene_object_hypothesis_id = beams[beam_idx].scene_object_hypothesis_id_;
+					scene_object_hypothesis_id[object_pose_label] = hypothesis_test.hypothesis_idx_;
+					SceneHypothesis observed_scene(test_result.vertex_map_, test_result.scene_support_graph_,
+						scene_hypothesis_probability, scene_object_hypothesis_id);
+					scene_hypotheses_list.push_back(observed_scene);
+					// std::cerr << "-------------------------------------------------------------\n\n";
 				}
-				std::cerr << "Best scene probability: " << best_object_probability_effect << std::endl;
+			}
+			if (number_of_last_stage_tests > 0 && use_successive_halving)
+			{
+				evaluation_report.estimated_saved_ticks_ += number_of_eliminated_tests * last_stage_ticks / number_of_last_stage_tests;
+			}
+			if (use_successive_halving)
+			{
+				std::cerr << "Successive halving of " << object_pose_label << " saved an estimated " 
+					<< evaluation_report.estimated_saved_ticks_ << " simulation ticks.\n";
+			}
 
-				SceneHypothesis observed_scene(vertex_map_,scene_support_graph_,
-					scene_hypothesis_probability, scene_object_hypothesis_id);
-				scene_hypotheses_list.push_back(observed_scene);
-				// std::cerr << "-------------------------------------------------------------\n\n";
+			// a beam without a valid hypothesis keeps the first hypothesis of the object
+			for (std::size_t beam_idx = 0; beam_idx < beams.size(); ++beam_idx)
+			{
+				if (beam_has_candidate[beam_idx] || number_of_object_hypotheses == 0) continue;
+				SceneBeamCandidate beam_candidate;
+				beam_candidate.test_idx_ = test_results.size();
+				beam_candidate.beam_idx_ = beam_idx;
+				beam_candidate.hypothesis_idx_ = 0;
+				beam_candidate.object_pose_ = object_pose_hypotheses[0];
+				beam_candidate.background_support_status_ = current_background_support_status[beam_idx];
+				beam_candidate.scene_probability_ = 0;
+				beam_candidates.push_back(beam_candidate);
 			}
-			
-			// only update if this object provides valid best object pose
-			// if (update_from_this_object)
+			object_fully_evaluated[object_pose_label] = !evaluation_interrupted;
+			unsigned int object_simulation_ticks = settle_simulation_ticks + getNumberOfSimulatedTicks(test_results);
+			spent_simulation_ticks += object_simulation_ticks;
+			if (this->hypothesis_simulation_budget_ > 0)
+			{
+				std::cerr << object_pose_label << " used " << object_simulation_ticks << " of " 
+					<< object_simulation_budget << " allocated simulation ticks.\n";
+			}
+			if (beam_candidates.empty()) continue;
+
+			// keep the best candidates, ties are resolved by the test order
+			std::stable_sort(beam_candidates.begin(), beam_candidates.end(), compare_beam_candidate);
+			if (beam_candidates.size() > this->scene_beam_width_) beam_candidates.resize(this->scene_beam_width_);
+
+			std::vector<SceneBeam> updated_beams;
+			std::cerr << "========================= \n";
+			for (std::vector<SceneBeamCandidate>::const_iterator cand_it = beam_candidates.begin(); 
+				cand_it != beam_candidates.end(); ++cand_it)
 			{
-				seq_mtx_.lock();
-				std::cerr << "========================= \n";
 				std::cerr << "Update the best map from object: " << object_pose_label 
-					<< " hypothesis #" << best_hypothesis_id + 1 << std::endl;
-				std::cerr << "========================= \n";
-				this->physics_engine_->changeBestTestPoseMap(object_pose_label, best_object_pose);
-				scene_object_hypothesis_id[object_pose_label] = best_hypothesis_id;
-				this->data_forces_generator_.removeCachedIcpResult(object_pose_label);
-				// this->physics_engine_->changeBestTestPoseMap(best_object_pose_from_graph);
-				seq_mtx_.unlock();
+					<< " hypothesis #" << cand_it->hypothesis_idx_ + 1;
+				if (this->scene_beam_width_ > 1) std::cerr << " on beam #" << cand_it->beam_idx_ + 1 
+					<< ", scene probability: " << cand_it->scene_probability_;
+				std::cerr << std::endl;
+
+				SceneBeam updated_beam = beams[cand_it->beam_idx_];
+				updated_beam.best_test_pose_map_[object_pose_label] = cand_it->object_pose_;
+				updated_beam.object_background_support_status_[object_pose_label] = cand_it->background_support_status_;
+				updated_beam.scene_object_hypothesis_id_[object_pose_label] = cand_it->hypothesis_idx_;
+				updated_beam.scene_probability_ = cand_it->scene_probability_;
+				updated_beam.data_forces_generator_.removeCachedIcpResult(object_pose_label);
+				if (cand_it->test_idx_ < test_results.size())
+				{
+					const std::map<std::string, double> &object_probability_map = 
+						test_results[cand_it->test_idx_].object_probability_map_;
+					for (std::map<std::string, double>::const_iterator prob_it = object_probability_map.begin(); 
+						prob_it != object_probability_map.end(); ++prob_it)
+					{
+						updated_beam.object_probabilities_[prob_it->first] = prob_it->second;
+					}
+				}
+				updated_beams.push_back(updated_beam);
 			}
+			std::cerr << "========================= \n";
+			beams.swap(updated_beams);
 		}
 		
 	}
+
 	// set the position to the best result for all objects
+	seq_mtx_.lock();
+	this->physics_engine_->changeBestTestPoseMap(beams[0].best_test_pose_map_);
+	this->data_forces_generator_ = beams[0].data_forces_generator_;
+	std::map<std::string, int> scene_object_hypothesis_id = beams[0].scene_object_hypothesis_id_;
+	seq_mtx_.unlock();
+
+	// the final scenes of the other beams are evaluated on the workers, unless there is no time or budget left
+	std::vector<SceneBeam> other_beams;
+	bool budget_reached = this->hypothesis_simulation_budget_ > 0 && 
+		spent_simulation_ticks >= this->hypothesis_simulation_budget_;
+	if (!budget_reached && !this->checkEvaluationDeadlineReached()) other_beams.assign(beams.begin() + 1, beams.end());
+	std::vector<ObjectHypothesisTestResult> other_beam_results(other_beams.size());
+	this->physics_engine_pool_.runJobs(other_beams.size(),
+		boost::bind(&SceneHypothesisAssessor::evaluateSceneBeam, this, _1, _2,
+			boost::cref(other_beams), boost::cref(object_action_map), boost::ref(other_beam_results)));
+	spent_simulation_ticks += getNumberOfSimulatedTicks(other_beam_results);
+	if (this->hypothesis_simulation_budget_ > 0)
+	{
+		std::cerr << "Hypotheses evaluation used " << spent_simulation_ticks << " of " 
+			<< this->hypothesis_simulation_budget_ << " simulation ticks.\n";
+	}
+
 	this->physics_engine_->prepareSimulationForWithBestTestPose();
 	this->physics_engine_->setSimulationMode(RESET_VELOCITY_ON_EACH_FRAME,GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER),
 		GRAVITY_SCALE_COMPENSATION*3);
-	this->physics_engine_->stepSimulationWithoutEvaluation(0.15 * GRAVITY_SCALE_COMPENSATION, 
+	if (!this->frame_warm_start_objects_.empty())
+	{
+		this->physics_engine_->setWarmStartContacts(this->previous_frame_contacts_, this->frame_warm_start_objects_);
+	}
+	this->settleSimulation(*this->physics_engine_, 0.15 * GRAVITY_SCALE_COMPENSATION, 
 			GRAVITY_SCALE_COMPENSATION/(120. * SIMULATION_FREQUENCY_MULTIPLIER));
-	this->physics_engine_->stepSimulationWithoutEvaluation(0.5/GRAVITY_SCALE_COMPENSATION, 
+	this->settleSimulation(*this->physics_engine_, 0.5/GRAVITY_SCALE_COMPENSATION, 
 			GRAVITY_SCALE_COMPENSATION/120.,false);
 	this->getUpdatedSceneSupportGraph();
 
@@ -838,9 +1865,31 @@ void SceneHypothesisAssessor::evaluateAllObjectHypothesisProbability()
 	std::cerr << "Final scene structure:\n";
 	write_graphviz(std::cerr, this->scene_support_graph_, label_writer(this->scene_support_graph_));
 
+	OneFrameSceneHypotheses beam_scene_hypotheses;
+	beam_scene_hypotheses.push_back(final_scene);
+	for (std::size_t beam_idx = 0; beam_idx < other_beams.size(); ++beam_idx)
+	{
+		const ObjectHypothesisTestResult &beam_result = other_beam_results[beam_idx];
+		// objects without probability are skipped, the same as the final scene of the best beam
+		double beam_scene_probability = 1;
+		const std::vector<double> &object_probabilities = beam_result.object_probabilities_[0];
+		for (std::vector<double>::const_iterator it = object_probabilities.begin(); it != object_probabilities.end(); ++it)
+		{
+			if (*it != 0) beam_scene_probability *= *it;
+		}
+		std::cerr << "Beam #" << beam_idx + 2 << " final scene:\n" << beam_result.evaluation_log_[0]
+			<< "Scene probability = " << beam_scene_probability << std::endl;
+		beam_scene_hypotheses.push_back(SceneHypothesis(beam_result.vertex_map_, beam_result.scene_support_graph_,
+			beam_scene_probability, other_beams[beam_idx].scene_object_hypothesis_id_));
+	}
+
 	this->current_scene_ = SceneObservation(final_scene, scene_hypotheses_list, this->object_label_class_map);
+	this->current_scene_.hypotheses_evaluation_report_ = hypotheses_evaluation_report;
+	this->current_scene_.beam_scene_hypotheses_ = beam_scene_hypotheses;
+	this->current_scene_.object_fully_evaluated_ = object_fully_evaluated;
 	
 	this->obj_previous_frame_pose_ = this->physics_engine_->getCurrentObjectPoses();
+	if (this->contact_warm_starting_) this->previous_frame_contacts_ = this->physics_engine_->captureWorldCheckpoint(true);
 	std::cerr << std::endl << std::endl;
 	// return scene_hypothesis;
 }
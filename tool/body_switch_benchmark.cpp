@@ -0,0 +1,117 @@
+// Measure the cost of switching the objects in and out of a hypothesis test, with the bodies removed from
+// the world and with the bodies kept resident in the broadphase, as the number of objects grows.
+// Usage: body_switch_benchmark [switches = 200]
+
+#include <iostream>
+#include <cstdlib>
+#include <sstream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "scene_physics_engine.h"
+
+const std::string BOX_CLASS = "benchmark_box";
+const btScalar BOX_HALF_EXTENT = 0.025;
+
+PointCloudXYZPtr generateBoxSurfaceCloud(const btScalar &half_extent, const int &points_per_edge)
+{
+	PointCloudXYZPtr cloud(new PointCloudXYZ());
+	btScalar step = 2 * half_extent / (points_per_edge - 1);
+	for (int face = 0; face < 6; face++)
+	{
+		int axis = face / 2;
+		btScalar side = face % 2 == 0 ? -half_extent : half_extent;
+		for (int i = 0; i < points_per_edge; i++)
+		{
+			for (int j = 0; j < points_per_edge; j++)
+			{
+				btScalar point[3];
+				point[axis] = side;
+				point[(axis + 1) % 3] = -half_extent + i * step;
+				point[(axis + 2) % 3] = -half_extent + j * step;
+				cloud->push_back(pcl::PointXYZ(point[0], point[1], point[2]));
+			}
+		}
+	}
+	return cloud;
+}
+
+// boxes stacked in resting layers of 3x3, so every object has contacts without moving much
+std::vector<ObjectWithID> generateStackedBoxes(const int &number_of_objects, const Object &box)
+{
+	std::vector<ObjectWithID> objects(number_of_objects);
+	const int objects_per_layer = 9;
+	for (int i = 0; i < number_of_objects; i++)
+	{
+		int layer = i / objects_per_layer;
+		int cell = i % objects_per_layer;
+		btVector3 position((cell % 3 - 1) * 0.051, BOX_HALF_EXTENT + layer * 2 * BOX_HALF_EXTENT, (cell / 3 - 1) * 0.051);
+
+		std::stringstream ss;
+		ss << BOX_CLASS << "/" << i;
+		objects[i].assignPhysicalPropertyFromObject(box);
+		objects[i].assignData(ss.str(), btTransform(btQuaternion::getIdentity(), position * SCALING), BOX_CLASS);
+	}
+	return objects;
+}
+
+// returns the wall clock seconds of one switch, averaged over the switches. Every switch removes the
+// object on top, runs one tick, then puts it back and runs one more tick, like a hypothesis test does.
+double runSwitches(const bool &resident_bodies, const std::vector<ObjectWithID> &objects,
+	std::map<std::string, ObjectPenaltyParameters> &penalty_database, FeedbackDataForcesGenerator &data_forces_generator,
+	const int &number_of_switches)
+{
+	PhysicsEngine engine;
+	engine.setResidentBodies(resident_bodies);
+	engine.setObjectPenaltyDatabase(&penalty_database);
+	engine.setFeedbackDataForcesGenerator(&data_forces_generator);
+	engine.setGravityVectorDirection(btVector3(0,-1,0));
+	engine.addBackgroundPlane(btVector3(0,1,0), 0, btVector3(0,0,0));
+	engine.addObjects(objects);
+
+	const double simulation_step = 1./120;
+	engine.setSimulationMode(BULLET_DEFAULT, simulation_step);
+	engine.stepSimulationWithoutEvaluation(simulation_step, simulation_step, false);
+
+	WorldCheckpoint full_scene = engine.captureWorldCheckpoint();
+	WorldCheckpoint partial_scene = full_scene;
+	partial_scene.body_state_.erase(objects.back().getID());
+
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	for (int i = 0; i < number_of_switches; i++)
+	{
+		engine.restoreWorldCheckpoint(i % 2 == 0 ? partial_scene : full_scene);
+		engine.stepSimulationWithoutEvaluation(simulation_step, simulation_step, false);
+	}
+	boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::local_time() - start;
+
+	engine.resetObjects(true);
+	return elapsed.total_microseconds() / 1e6 / number_of_switches;
+}
+
+int main(int argc, char* argv[])
+{
+	int number_of_switches = argc > 1 ? std::atoi(argv[1]) : 200;
+	if (number_of_switches < 2) number_of_switches = 2;
+
+	Object box;
+	box.setPhysicalProperties(new btBoxShape(btVector3(1,1,1) * BOX_HALF_EXTENT * SCALING), PhysicalProperties(0.1, 1., 1.));
+
+	std::map<std::string, ObjectPenaltyParameters> penalty_database;
+	penalty_database[BOX_CLASS] = ObjectPenaltyParameters();
+	FeedbackDataForcesGenerator data_forces_generator;
+	data_forces_generator.setModelCloud(generateBoxSurfaceCloud(BOX_HALF_EXTENT, 5), BOX_CLASS);
+
+	const int scene_sizes[] = {10, 30, 60, 100, 200};
+	std::cout << "objects\tremoved (ms per switch)\tresident (ms per switch)\tspeedup\n";
+	for (std::size_t i = 0; i < sizeof(scene_sizes) / sizeof(scene_sizes[0]); i++)
+	{
+		std::vector<ObjectWithID> objects = generateStackedBoxes(scene_sizes[i], box);
+		double removed_seconds = runSwitches(false, objects, penalty_database, data_forces_generator, number_of_switches);
+		double resident_seconds = runSwitches(true, objects, penalty_database, data_forces_generator, number_of_switches);
+		std::cout << scene_sizes[i] << "\t" << removed_seconds * 1e3 << "\t" << resident_seconds * 1e3 << "\t"
+			<< removed_seconds / resident_seconds << "\n";
+	}
+
+	box.deleteMeshContent();
+	return 0;
+}
@@ -0,0 +1,149 @@
+// Compare the broadphases on the hypothesis test pattern of the scene assessor: every test restores the scene
+// with one object moved to a new pose hypothesis, then simulates a short window.
+// Usage: broadphase_benchmark [tests = 200] [ticks per test = 10]
+
+#include <iostream>
+#include <cstdlib>
+#include <sstream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "scene_physics_engine.h"
+
+const std::string BOX_CLASS = "benchmark_box";
+const btScalar BOX_HALF_EXTENT = 0.025;
+const char* BROADPHASE_NAMES[] = {"dbvt", "axis sweep", "brute force"};
+
+PointCloudXYZPtr generateBoxSurfaceCloud(const btScalar &half_extent, const int &points_per_edge)
+{
+	PointCloudXYZPtr cloud(new PointCloudXYZ());
+	btScalar step = 2 * half_extent / (points_per_edge - 1);
+	for (int face = 0; face < 6; face++)
+	{
+		int axis = face / 2;
+		btScalar side = face % 2 == 0 ? -half_extent : half_extent;
+		for (int i = 0; i < points_per_edge; i++)
+		{
+			for (int j = 0; j < points_per_edge; j++)
+			{
+				btScalar point[3];
+				point[axis] = side;
+				point[(axis + 1) % 3] = -half_extent + i * step;
+				point[(axis + 2) % 3] = -half_extent + j * step;
+				cloud->push_back(pcl::PointXYZ(point[0], point[1], point[2]));
+			}
+		}
+	}
+	return cloud;
+}
+
+// boxes stacked in resting layers of 3x3, like objects piled on a table
+std::vector<ObjectWithID> generateStackedBoxes(const int &number_of_objects, const Object &box)
+{
+	std::vector<ObjectWithID> objects(number_of_objects);
+	const int objects_per_layer = 9;
+	for (int i = 0; i < number_of_objects; i++)
+	{
+		int layer = i / objects_per_layer;
+		int cell = i % objects_per_layer;
+		btVector3 position((cell % 3 - 1) * 0.051, BOX_HALF_EXTENT + layer * 2 * BOX_HALF_EXTENT, (cell / 3 - 1) * 0.051);
+
+		std::stringstream ss;
+		ss << BOX_CLASS << "/" << i;
+		objects[i].assignPhysicalPropertyFromObject(box);
+		objects[i].assignData(ss.str(), btTransform(btQuaternion::getIdentity(), position * SCALING), BOX_CLASS);
+	}
+	return objects;
+}
+
+// returns false if the broadphase could not be used. The times are wall clock seconds per test.
+bool runTests(const int &broadphase_type, const std::vector<ObjectWithID> &objects,
+	std::map<std::string, ObjectPenaltyParameters> &penalty_database, FeedbackDataForcesGenerator &data_forces_generator,
+	const int &number_of_tests, const int &ticks_per_test, double &restore_seconds, double &simulation_seconds)
+{
+	PhysicsEngine engine;
+	if (!engine.setBroadphase(broadphase_type)) return false;
+	engine.setObjectPenaltyDatabase(&penalty_database);
+	engine.setFeedbackDataForcesGenerator(&data_forces_generator);
+	engine.setGravityVectorDirection(btVector3(0,-1,0));
+	engine.addBackgroundPlane(btVector3(0,1,0), 0, btVector3(0,0,0));
+	engine.addObjects(objects);
+
+	const double simulation_step = 1./120;
+	engine.setSimulationMode(BULLET_DEFAULT, simulation_step);
+	engine.stepSimulationWithoutEvaluation(simulation_step, simulation_step, false);
+	WorldCheckpoint scene = engine.captureWorldCheckpoint();
+
+	std::srand(4321);
+	boost::posix_time::time_duration restore_time, simulation_time;
+	for (int i = 0; i < number_of_tests; i++)
+	{
+		// pose hypothesis of the tested object, a few centimeters from its current pose
+		WorldCheckpoint test_scene = scene;
+		WorldCheckpoint::BodyState &tested_object = test_scene.body_state_[objects[i % objects.size()].getID()];
+		btVector3 offset(std::rand() / (btScalar)RAND_MAX - 0.5, std::rand() / (btScalar)RAND_MAX,
+			std::rand() / (btScalar)RAND_MAX - 0.5);
+		tested_object.transform_.getOrigin() += offset * 0.04 * SCALING;
+		tested_object.activation_state_ = ACTIVE_TAG;
+
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+		engine.restoreWorldCheckpoint(test_scene);
+		boost::posix_time::ptime restored = boost::posix_time::microsec_clock::local_time();
+		engine.stepSimulationWithoutEvaluation(ticks_per_test * simulation_step, simulation_step, false);
+		simulation_time += boost::posix_time::microsec_clock::local_time() - restored;
+		restore_time += restored - start;
+	}
+
+	engine.resetObjects(true);
+	restore_seconds = restore_time.total_microseconds() / 1e6 / number_of_tests;
+	simulation_seconds = simulation_time.total_microseconds() / 1e6 / number_of_tests;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	int number_of_tests = argc > 1 ? std::atoi(argv[1]) : 200;
+	int ticks_per_test = argc > 2 ? std::atoi(argv[2]) : 10;
+	if (number_of_tests < 1) number_of_tests = 1;
+	if (ticks_per_test < 1) ticks_per_test = 1;
+
+	Object box;
+	box.setPhysicalProperties(new btBoxShape(btVector3(1,1,1) * BOX_HALF_EXTENT * SCALING), PhysicalProperties(0.1, 1., 1.));
+
+	std::map<std::string, ObjectPenaltyParameters> penalty_database;
+	penalty_database[BOX_CLASS] = ObjectPenaltyParameters();
+	FeedbackDataForcesGenerator data_forces_generator;
+	data_forces_generator.setModelCloud(generateBoxSurfaceCloud(BOX_HALF_EXTENT, 5), BOX_CLASS);
+
+	const int scene_sizes[] = {5, 10, 20, 40};
+	std::cout << "objects\tbroadphase\trestore (ms per test)\tsimulation (ms per test)\ttotal (ms per test)\n";
+	for (std::size_t i = 0; i < sizeof(scene_sizes) / sizeof(scene_sizes[0]); i++)
+	{
+		std::vector<ObjectWithID> objects = generateStackedBoxes(scene_sizes[i], box);
+		int fastest_broadphase = -1;
+		double fastest_seconds = 0;
+		for (int broadphase_type = DBVT_BROADPHASE; broadphase_type <= BRUTE_FORCE_BROADPHASE; broadphase_type++)
+		{
+			double restore_seconds, simulation_seconds;
+			if (!runTests(broadphase_type, objects, penalty_database, data_forces_generator,
+				number_of_tests, ticks_per_test, restore_seconds, simulation_seconds))
+			{
+				std::cerr << "Failed to use the " << BROADPHASE_NAMES[broadphase_type] << " broadphase.\n";
+				continue;
+			}
+
+			double total_seconds = restore_seconds + simulation_seconds;
+			if (fastest_broadphase < 0 || total_seconds < fastest_seconds)
+			{
+				fastest_broadphase = broadphase_type;
+				fastest_seconds = total_seconds;
+			}
+			std::cout << scene_sizes[i] << "\t" << BROADPHASE_NAMES[broadphase_type] << "\t" << restore_seconds * 1e3 << "\t"
+				<< simulation_seconds * 1e3 << "\t" << total_seconds * 1e3 << "\n";
+		}
+		if (fastest_broadphase >= 0) std::cout << scene_sizes[i] << " objects: use broadphase "
+			<< fastest_broadphase << " (" << BROADPHASE_NAMES[fastest_broadphase] << ")\n";
+	}
+
+	box.deleteMeshContent();
+	return 0;
+}
@@ -0,0 +1,142 @@
+// Compare the single threaded world with the task scheduler world on synthetic piles of boxes.
+// Usage: physics_world_benchmark [world threads = 4] [repeats = 3] [simulated seconds = 2]
+
+#include <iostream>
+#include <cstdlib>
+#include <sstream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "scene_physics_engine.h"
+
+const std::string BOX_CLASS = "benchmark_box";
+const btScalar BOX_HALF_EXTENT = 0.025;
+
+PointCloudXYZPtr generateBoxSurfaceCloud(const btScalar &half_extent, const int &points_per_edge)
+{
+	PointCloudXYZPtr cloud(new PointCloudXYZ());
+	btScalar step = 2 * half_extent / (points_per_edge - 1);
+	for (int face = 0; face < 6; face++)
+	{
+		int axis = face / 2;
+		btScalar side = face % 2 == 0 ? -half_extent : half_extent;
+		for (int i = 0; i < points_per_edge; i++)
+		{
+			for (int j = 0; j < points_per_edge; j++)
+			{
+				btScalar point[3];
+				point[axis] = side;
+				point[(axis + 1) % 3] = -half_extent + i * step;
+				point[(axis + 2) % 3] = -half_extent + j * step;
+				cloud->push_back(pcl::PointXYZ(point[0], point[1], point[2]));
+			}
+		}
+	}
+	return cloud;
+}
+
+// boxes dropped in layers over a small area, so they settle into a pile with many contacts
+std::vector<btTransform> generatePilePoses(const int &number_of_objects, const unsigned int &seed)
+{
+	std::srand(seed);
+	std::vector<btTransform> poses;
+	const int objects_per_layer = 9;
+	for (int i = 0; i < number_of_objects; i++)
+	{
+		int layer = i / objects_per_layer;
+		int cell = i % objects_per_layer;
+		btScalar jitter_x = (std::rand() / (btScalar)RAND_MAX - 0.5) * 0.02;
+		btScalar jitter_z = (std::rand() / (btScalar)RAND_MAX - 0.5) * 0.02;
+		btVector3 position((cell % 3 - 1) * 0.06 + jitter_x, 0.03 + layer * 0.055, (cell / 3 - 1) * 0.06 + jitter_z);
+
+		btQuaternion orientation(btVector3(std::rand() / (btScalar)RAND_MAX, 1., std::rand() / (btScalar)RAND_MAX).normalized(),
+			std::rand() / (btScalar)RAND_MAX * SIMD_PI);
+		poses.push_back(btTransform(orientation, position * SCALING));
+	}
+	return poses;
+}
+
+// returns the wall clock seconds used for the simulation
+double runPile(const unsigned int &world_threads, const std::vector<btTransform> &poses, const Object &box,
+	std::map<std::string, ObjectPenaltyParameters> &penalty_database, FeedbackDataForcesGenerator &data_forces_generator,
+	const double &simulated_seconds, unsigned int &simulated_ticks)
+{
+	PhysicsEngine engine;
+	if (!engine.setWorldThreadCount(world_threads)) return -1;
+	engine.setObjectPenaltyDatabase(&penalty_database);
+	engine.setFeedbackDataForcesGenerator(&data_forces_generator);
+	engine.setGravityVectorDirection(btVector3(0,-1,0));
+	engine.addBackgroundPlane(btVector3(0,1,0), 0, btVector3(0,0,0));
+
+	std::vector<ObjectWithID> objects(poses.size());
+	for (std::size_t i = 0; i < poses.size(); i++)
+	{
+		std::stringstream ss;
+		ss << BOX_CLASS << "/" << i;
+		objects[i].assignPhysicalPropertyFromObject(box);
+		objects[i].assignData(ss.str(), poses[i], BOX_CLASS);
+	}
+	engine.addObjects(objects);
+
+	const double simulation_step = 1./120;
+	engine.setSimulationMode(BULLET_DEFAULT, simulation_step);
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	engine.stepSimulationWithoutEvaluation(simulated_seconds, simulation_step, false);
+	boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::local_time() - start;
+	simulated_ticks = engine.getNumberOfSimulatedTicks();
+
+	engine.resetObjects(true);
+	return elapsed.total_microseconds() / 1e6;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int world_threads = argc > 1 ? std::atoi(argv[1]) : 4;
+	int repeats = argc > 2 ? std::atoi(argv[2]) : 3;
+	double simulated_seconds = argc > 3 ? std::atof(argv[3]) : 2.;
+	if (repeats < 1) repeats = 1;
+
+	Object box;
+	box.setPhysicalProperties(new btBoxShape(btVector3(1,1,1) * BOX_HALF_EXTENT * SCALING), PhysicalProperties(0.1, 1., 1.));
+
+	std::map<std::string, ObjectPenaltyParameters> penalty_database;
+	penalty_database[BOX_CLASS] = ObjectPenaltyParameters();
+	FeedbackDataForcesGenerator data_forces_generator;
+	data_forces_generator.setModelCloud(generateBoxSurfaceCloud(BOX_HALF_EXTENT, 5), BOX_CLASS);
+
+	const int pile_sizes[] = {10, 30, 60, 100};
+	std::cout << "objects\tworld threads\tticks\tseconds\tticks per second\tspeedup\n";
+	for (std::size_t i = 0; i < sizeof(pile_sizes) / sizeof(pile_sizes[0]); i++)
+	{
+		std::vector<btTransform> poses = generatePilePoses(pile_sizes[i], 1234 + i);
+		double single_thread_seconds = 0;
+
+		unsigned int thread_counts[] = {1, world_threads};
+		for (int t = 0; t < 2; t++)
+		{
+			if (t == 1 && world_threads <= 1) break;
+			double total_seconds = 0;
+			unsigned int simulated_ticks = 0;
+			bool failed = false;
+			for (int r = 0; r < repeats && !failed; r++)
+			{
+				double seconds = runPile(thread_counts[t], poses, box, penalty_database, data_forces_generator,
+					simulated_seconds, simulated_ticks);
+				if (seconds < 0) failed = true;
+				total_seconds += seconds;
+			}
+			if (failed)
+			{
+				std::cerr << "Failed to use " << thread_counts[t] << " world threads.\n";
+				break;
+			}
+
+			double seconds = total_seconds / repeats;
+			if (t == 0) single_thread_seconds = seconds;
+			std::cout << pile_sizes[i] << "\t" << thread_counts[t] << "\t" << simulated_ticks << "\t"
+				<< seconds << "\t" << simulated_ticks / seconds << "\t" << single_thread_seconds / seconds << "\n";
+		}
+	}
+
+	box.deleteMeshContent();
+	return 0;
+}
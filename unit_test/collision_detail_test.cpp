@@ -0,0 +1,126 @@
+#include <iostream>
+#include <algorithm>
+
+#include "object_data_property.h"
+#include "unit_test_utility.h"
+
+// compound mesh with one box hull, like the meshes from the convex decomposition
+btCompoundShape* generateBoxMesh(const btVector3 &half_extents, const btScalar &margin)
+{
+	btConvexHullShape* box_hull = new btConvexHullShape();
+	for (int i = 0; i < 8; ++i)
+	{
+		box_hull->addPoint(btVector3(i & 1 ? half_extents[0] : -half_extents[0], i & 2 ? half_extents[1] : -half_extents[1],
+			i & 4 ? half_extents[2] : -half_extents[2]), false);
+	}
+	box_hull->recalcLocalAabb();
+	box_hull->setMargin(margin);
+	btCompoundShape* mesh = new btCompoundShape();
+	mesh->addChildShape(btTransform::getIdentity(), box_hull);
+	return mesh;
+}
+
+void testObbOverlap()
+{
+	btVector3 unit_half_extents(1., 1., 1.);
+	btTransform pose_a = btTransform::getIdentity(), pose_b = btTransform::getIdentity();
+
+	pose_b.setOrigin(btVector3(1.5, 0., 0.));
+	checkResult("overlapping boxes", checkObbOverlap(pose_a, unit_half_extents, pose_b, unit_half_extents, 0.));
+	checkResult("overlapping boxes are symmetric",
+		checkObbOverlap(pose_b, unit_half_extents, pose_a, unit_half_extents, 0.));
+
+	pose_b.setOrigin(btVector3(2.5, 0., 0.));
+	checkResult("separated boxes", !checkObbOverlap(pose_a, unit_half_extents, pose_b, unit_half_extents, 0.));
+	checkResult("separated boxes within the margin",
+		checkObbOverlap(pose_a, unit_half_extents, pose_b, unit_half_extents, 0.6));
+	checkResult("separated boxes outside the margin",
+		!checkObbOverlap(pose_a, unit_half_extents, pose_b, unit_half_extents, 0.4));
+
+	// a box rotated by 45 degrees on z reaches sqrt(2) along x, so only its edge can touch the other box
+	pose_b.setRotation(btQuaternion(btVector3(0., 0., 1.), SIMD_PI / 4));
+	pose_b.setOrigin(btVector3(2.3, 0., 0.));
+	checkResult("rotated box touching with its edge",
+		checkObbOverlap(pose_a, unit_half_extents, pose_b, unit_half_extents, 0.));
+	pose_b.setOrigin(btVector3(2.5, 0., 0.));
+	checkResult("rotated box separated from the face",
+		!checkObbOverlap(pose_a, unit_half_extents, pose_b, unit_half_extents, 0.));
+
+	// the edge of a box rotated on x crosses the edge of a box rotated on z, they touch at a distance of 2 sqrt(2)
+	// and only the cross product of the edges separates them up to a distance of about 3.8
+	btTransform edge_pose_a = btTransform::getIdentity(), edge_pose_b = btTransform::getIdentity();
+	edge_pose_a.setRotation(btQuaternion(btVector3(1., 0., 0.), SIMD_PI / 4));
+	edge_pose_b.setRotation(btQuaternion(btVector3(0., 0., 1.), SIMD_PI / 4));
+	edge_pose_b.setOrigin(btVector3(0., 3., 0.));
+	checkResult("edge-edge separated boxes",
+		!checkObbOverlap(edge_pose_a, unit_half_extents, edge_pose_b, unit_half_extents, 0.));
+	checkResult("edge-edge separated boxes within the margin",
+		checkObbOverlap(edge_pose_a, unit_half_extents, edge_pose_b, unit_half_extents, 0.2));
+	checkResult("edge-edge separated boxes outside the margin",
+		!checkObbOverlap(edge_pose_a, unit_half_extents, edge_pose_b, unit_half_extents, 0.1));
+	edge_pose_b.setOrigin(btVector3(0., 2.7, 0.));
+	checkResult("edge-edge overlapping boxes",
+		checkObbOverlap(edge_pose_a, unit_half_extents, edge_pose_b, unit_half_extents, 0.));
+}
+
+void testCollisionDetailShapes()
+{
+	btScalar margin = 0.04;
+	btVector3 half_extents(2., 1., 0.5);
+	Object box;
+	box.setPhysicalProperties(generateBoxMesh(half_extents, margin), PhysicalProperties(1., 1., 1.));
+
+	objectShapePtr full_shape = box.getCollisionShape();
+	checkResult("full detail level is the mesh", box.getCollisionShape(COLLISION_DETAIL_FULL) == full_shape);
+	checkResult("invalid detail level falls back to the mesh", box.getCollisionShape(-1) == full_shape);
+	checkResult("coarse detail levels are generated", box.getCollisionShape(COLLISION_DETAIL_OBB) != full_shape &&
+		box.getCollisionShape(COLLISION_DETAIL_HULL) != full_shape);
+	checkResult("detail levels are generated only once", !box.generateCollisionDetailShapes());
+
+	btCollisionObject body;
+	body.setCollisionShape(box.getCollisionShape(COLLISION_DETAIL_HULL));
+	const CollisionDetailShapes* detail_shapes = getCollisionDetailShapes(&body);
+	checkResult("detail levels share the detail shapes", detail_shapes != NULL &&
+		box.getCollisionShape(COLLISION_DETAIL_OBB)->getUserPointer() == detail_shapes &&
+		full_shape->getUserPointer() == detail_shapes);
+	if (detail_shapes == NULL) return;
+
+	// the box includes the collision margin, the axes of the box may be in any order
+	std::vector<btScalar> obb_extents(3), expected_extents(3);
+	for (int i = 0; i < 3; ++i)
+	{
+		obb_extents[i] = detail_shapes->obb_half_extents_[i];
+		expected_extents[i] = half_extents[i] + margin;
+	}
+	std::sort(obb_extents.begin(), obb_extents.end());
+	std::sort(expected_extents.begin(), expected_extents.end());
+	for (int i = 0; i < 3; ++i) checkNear("bounding box half extents", obb_extents[i], expected_extents[i], 1e-3);
+	checkNear("bounding box center", detail_shapes->obb_pose_.getOrigin().length(), 0., 1e-3);
+
+	// every level covers the same space as the full shape, up to the collision margins
+	btVector3 full_min, full_max;
+	full_shape->getAabb(btTransform::getIdentity(), full_min, full_max);
+	for (int level = 0; level < COLLISION_DETAIL_FULL; ++level)
+	{
+		btVector3 level_min, level_max;
+		box.getCollisionShape(level)->getAabb(btTransform::getIdentity(), level_min, level_max);
+		checkNear("detail level bounding box", (level_max - level_min - (full_max - full_min)).length(), 0., 4 * margin);
+	}
+
+	// meshes that are not compound shapes keep their only level
+	Object sphere;
+	sphere.setPhysicalProperties(new btSphereShape(1.), PhysicalProperties(1., 1., 1.));
+	checkResult("non compound mesh has no detail levels",
+		sphere.getCollisionShape(COLLISION_DETAIL_OBB) == sphere.getCollisionShape());
+
+	box.deleteMeshContent();
+	sphere.deleteMeshContent();
+}
+
+int main()
+{
+	testObbOverlap();
+	testCollisionDetailShapes();
+
+	return reportTestResult();
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+
+#include "sequential_scene_parsing.h"
+#include "unit_test_utility.h"
+
+btTransform generatePose(const double &yaw_degree, const btVector3 &position_meter)
+{
+	return btTransform(btQuaternion(btVector3(0., 0., 1.), yaw_degree * pi / 180.), position_meter * SCALING);
+}
+
+void testSymmetricRotationDistance(const std::map<std::string, ObjectSymmetry> &object_symmetry_map)
+{
+	btQuaternion identity = btQuaternion::getIdentity();
+	btQuaternion yaw_90(btVector3(0., 0., 1.), pi / 2);
+	btQuaternion yaw_30(btVector3(0., 0., 1.), pi / 6);
+	btQuaternion roll_90_yaw_90 = btQuaternion(btVector3(1., 0., 0.), pi / 2) * yaw_90;
+
+	checkNear("cube rotated by 90 degrees on z is identical", SceneHypothesisAssessor::getSymmetricRotationDistance(
+		identity, yaw_90, "cube", object_symmetry_map), 0., 1e-3);
+	checkNear("cube rotated by 90 degrees on x and z is identical", SceneHypothesisAssessor::getSymmetricRotationDistance(
+		identity, roll_90_yaw_90, "cube", object_symmetry_map), 0., 1e-3);
+	checkNear("cube rotated by 120 degrees on z is 30 degrees away", SceneHypothesisAssessor::getSymmetricRotationDistance(
+		identity, yaw_90 * yaw_30, "cube", object_symmetry_map), pi / 6, 1e-3);
+
+	// models without symmetry use the plain rotation angle
+	checkNear("plank rotated by 90 degrees on z is 90 degrees away", SceneHypothesisAssessor::getSymmetricRotationDistance(
+		identity, yaw_90, "plank", object_symmetry_map), pi / 2, 1e-3);
+	checkNear("plank rotated by 30 degrees on z is 30 degrees away", SceneHypothesisAssessor::getSymmetricRotationDistance(
+		yaw_90, yaw_90 * yaw_30, "plank", object_symmetry_map), pi / 6, 1e-3);
+}
+
+void testMergeDuplicatePoses(const std::map<std::string, ObjectSymmetry> &object_symmetry_map)
+{
+	double max_translation = 0.005, max_rotation = 5. * pi / 180.;
+
+	std::vector<btTransform> poses;
+	std::vector<double> data_confidences;
+	// within the translation threshold of the first pose, with a better confidence
+	poses.push_back(generatePose(0., btVector3(0., 0., 0.)));
+	data_confidences.push_back(0.5);
+	poses.push_back(generatePose(2., btVector3(0.003, 0., 0.)));
+	data_confidences.push_back(0.8);
+	// outside the translation threshold
+	poses.push_back(generatePose(0., btVector3(0.01, 0., 0.)));
+	data_confidences.push_back(0.6);
+	// symmetric equivalent of the first pose for the cube, with a worse confidence
+	poses.push_back(generatePose(90., btVector3(0., 0.002, 0.)));
+	data_confidences.push_back(0.7);
+
+	std::vector<btTransform> merged_poses;
+	std::vector<double> merged_confidences;
+	SceneHypothesisAssessor::mergeDuplicatePoses(poses, data_confidences, "cube", object_symmetry_map,
+		max_translation, max_rotation, merged_poses, merged_confidences);
+	checkResult("cube poses are merged into 2 clusters", merged_poses.size() == 2 && merged_confidences.size() == 2);
+	if (merged_poses.size() == 2)
+	{
+		checkResult("cube cluster keeps the pose with the best confidence",
+			merged_poses[0].getOrigin() == poses[1].getOrigin() && merged_confidences[0] == 0.8);
+		checkResult("cube cluster outside the translation threshold is kept",
+			merged_poses[1].getOrigin() == poses[2].getOrigin() && merged_confidences[1] == 0.6);
+	}
+
+	SceneHypothesisAssessor::mergeDuplicatePoses(poses, data_confidences, "plank", object_symmetry_map,
+		max_translation, max_rotation, merged_poses, merged_confidences);
+	checkResult("plank poses are merged into 3 clusters", merged_poses.size() == 3);
+	if (merged_poses.size() == 3)
+	{
+		checkResult("plank clusters are in the order of their first member",
+			merged_poses[0].getOrigin() == poses[1].getOrigin() && merged_poses[1].getOrigin() == poses[2].getOrigin() &&
+			merged_poses[2].getOrigin() == poses[3].getOrigin());
+	}
+
+	// a tighter translation threshold keeps every pose
+	SceneHypothesisAssessor::mergeDuplicatePoses(poses, data_confidences, "cube", object_symmetry_map,
+		0.001, max_rotation, merged_poses, merged_confidences);
+	checkResult("no poses are merged within 1 mm", merged_poses.size() == poses.size());
+
+	// every pose is within the threshold of the previous one, but the last is outside of the threshold of the first
+	std::vector<btTransform> chain_poses;
+	std::vector<double> chain_confidences;
+	for (int i = 0; i < 3; ++i)
+	{
+		chain_poses.push_back(generatePose(0., btVector3(0.004 * i, 0., 0.)));
+		chain_confidences.push_back(0.5 + 0.1 * i);
+	}
+	SceneHypothesisAssessor::mergeDuplicatePoses(chain_poses, chain_confidences, "plank", object_symmetry_map,
+		max_translation, max_rotation, merged_poses, merged_confidences);
+	checkResult("clusters do not drift to their best member", merged_poses.size() == 2);
+	if (merged_poses.size() == 2)
+	{
+		checkResult("drifting cluster keeps the pose with the best confidence",
+			merged_poses[0].getOrigin() == chain_poses[1].getOrigin() && merged_confidences[0] == chain_confidences[1]);
+	}
+}
+
+int main()
+{
+	// the cube looks the same after every 90 degree rotation, the plank has no symmetry entry
+	std::map<std::string, ObjectSymmetry> object_symmetry_map;
+	object_symmetry_map.insert(std::make_pair(std::string("cube"), ObjectSymmetry(pi / 2, pi / 2, pi / 2)));
+
+	testSymmetricRotationDistance(object_symmetry_map);
+	testMergeDuplicatePoses(object_symmetry_map);
+
+	return reportTestResult();
+}
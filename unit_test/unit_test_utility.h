@@ -0,0 +1,46 @@
+#ifndef UNIT_TEST_UTILITY_H
+#define UNIT_TEST_UTILITY_H
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+// number of failed checks of the test executable
+inline int &getNumberOfFailures()
+{
+	static int number_of_failures = 0;
+	return number_of_failures;
+}
+
+inline void checkResult(const std::string &test_name, const bool &result)
+{
+	if (result)
+	{
+		std::cerr << "PASSED: " << test_name << std::endl;
+	}
+	else
+	{
+		std::cerr << "FAILED: " << test_name << std::endl;
+		++getNumberOfFailures();
+	}
+}
+
+inline void checkNear(const std::string &test_name, const double &value, const double &expected, const double &tolerance)
+{
+	checkResult(test_name, std::abs(value - expected) <= tolerance);
+	if (std::abs(value - expected) > tolerance) std::cerr << "  value " << value << ", expected " << expected << std::endl;
+}
+
+// prints the summary of the checks, returns the exit code of the test executable
+inline int reportTestResult()
+{
+	if (getNumberOfFailures() > 0)
+	{
+		std::cerr << getNumberOfFailures() << " checks failed.\n";
+		return 1;
+	}
+	std::cerr << "All checks passed.\n";
+	return 0;
+}
+
+#endif